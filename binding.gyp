@@ -8,43 +8,79 @@
     ],
     'mdsf_debug_ccflags': ['-g', '-O0'],
     'mdsf_release_ccflags': ['-O3'],
-    'mdsf_use_short_unicode_tables': '<!(node ./tools/echo-env MDSF_USE_SHORT_UNICODE_TABLES)'
+    'mdsf_use_avx2': '<!(node ./tools/echo-env MDSF_USE_AVX2)'
+  },
+  'target_defaults': {
+    'conditions': [
+      ['mdsf_use_avx2', {
+        'cflags_cc': ['-mavx2'],
+        'xcode_settings': {
+          'OTHER_CPLUSPLUSFLAGS': ['-mavx2']
+        },
+        'msvs_settings': {
+          'VCCLCompilerTool': {
+            'EnableEnhancedInstructionSet': '5'
+          }
+        }
+      }]
+    ],
+    'configurations': {
+      'Debug': {
+        'cflags_cc': ['<@(mdsf_debug_ccflags)'],
+        'xcode_settings': {
+          'OTHER_CPLUSPLUSFLAGS': ['<@(mdsf_debug_ccflags)']
+        }
+      },
+      'Release': {
+        'cflags_cc': ['<@(mdsf_release_ccflags)'],
+        'xcode_settings': {
+          'OTHER_CPLUSPLUSFLAGS': ['<@(mdsf_release_ccflags)']
+        }
+      }
+    },
+    'cflags_cc': ['<@(mdsf_base_ccflags)'],
+    'xcode_settings': {
+      'OTHER_CPLUSPLUSFLAGS': [
+        '<@(mdsf_base_ccflags)',
+        '-stdlib=libc++'
+      ]
+    }
   },
   'targets': [
+    {
+      # The V8-independent parser core, linked into the addon and available
+      # to other native code.
+      'target_name': 'mdsf_core',
+      'type': 'static_library',
+      'sources': [
+        'src/arena.cc',
+        'src/number_parser.cc',
+        'src/simd_utils.cc',
+        'src/tape.cc',
+        'src/tokenizer.cc',
+        'src/unicode_utils.cc'
+      ],
+      'cflags': ['-fPIC'],
+      'direct_dependent_settings': {
+        'include_dirs': ['src']
+      }
+    },
     {
       'target_name': 'mdsf',
+      'dependencies': ['mdsf_core'],
       'sources': [
+        'src/async_parser.cc',
+        'src/external_string.cc',
+        'src/isolate_data.cc',
+        'src/key_cache.cc',
         'src/node_bindings.cc',
         'src/parser.cc',
+        'src/shape_cache.cc',
         'src/message_parser.cc',
-        'src/unicode_utils.cc'
-      ],
-      'conditions': [
-        ['not mdsf_use_short_unicode_tables', {
-          'defines': ['_PARSER_USE_FULL_TABLES_']
-        }]
-      ],
-      'configurations': {
-        'Debug': {
-          'cflags_cc': ['<@(mdsf_debug_ccflags)'],
-          'xcode_settings': {
-            'OTHER_CPLUSPLUSFLAGS': ['<@(mdsf_debug_ccflags)']
-          }
-        },
-        'Release': {
-          'cflags_cc': ['<@(mdsf_release_ccflags)'],
-          'xcode_settings': {
-            'OTHER_CPLUSPLUSFLAGS': ['<@(mdsf_release_ccflags)']
-          }
-        }
-      },
-      'cflags_cc': ['<@(mdsf_base_ccflags)'],
-      'xcode_settings': {
-        'OTHER_CPLUSPLUSFLAGS': [
-          '<@(mdsf_base_ccflags)',
-          '-stdlib=libc++'
-        ]
-      }
+        'src/schema_parser.cc',
+        'src/serializer.cc',
+        'src/stream_parser.cc'
+      ]
     }
   ]
 }
@@ -0,0 +1,154 @@
+'use strict';
+
+// Characters that make a string need escaping, including the surrogates, so
+// that strings without them can be quoted as they are
+//
+const ESCAPED_CHARACTERS = /['"\\\u0000-\u001F\uD800-\uDFFF]/;
+
+// Keys written without quotes, the same as in lib/stringify.js
+//
+const IDENTIFIER = /^[a-zA-Z_$][\w$]*$/;
+
+const hasMethods = value =>
+  typeof value.toMDSF === 'function' ||
+  (typeof value.toJSON === 'function' && !Buffer.isBuffer(value));
+
+// Check that a value of an 'any' field is serialized the same way with the
+// key it has in the holder as without it, and is not omitted
+//
+const isSerializable = value => {
+  const type = typeof value;
+  if (type === 'object') {
+    return value === null || !hasMethods(value);
+  }
+  return type !== 'function' && type !== 'symbol' && type !== 'bigint';
+};
+
+// Generator of the code of a specialized serializer. Every piece of the code
+// appends the serialization of a value to the `out` variable or returns
+// undefined if the value doesn't match the schema.
+//
+class Generator {
+  constructor(stringify) {
+    this.stringify = stringify;
+    this.variableCount = 0;
+  }
+
+  newVariable(name) {
+    return `${name}${this.variableCount++}`;
+  }
+
+  generate(schema, value) {
+    if (Array.isArray(schema)) {
+      return this.generateArray(schema, value);
+    }
+    if (typeof schema === 'object' && schema !== null) {
+      return this.generateObject(schema, value);
+    }
+    switch (schema) {
+      case 'string':
+        return (
+          `if (typeof ${value} !== 'string') return undefined;\n` +
+          `out += ESCAPED_CHARACTERS.test(${value}) ? ` +
+          `stringify(${value}) : "'" + ${value} + "'";\n`
+        );
+      case 'number':
+        return (
+          `if (typeof ${value} !== 'number') return undefined;\n` +
+          `out += ${value};\n`
+        );
+      case 'boolean':
+        return (
+          `if (typeof ${value} !== 'boolean') return undefined;\n` +
+          `out += ${value} ? 'true' : 'false';\n`
+        );
+      case 'any':
+        return (
+          `if (!isSerializable(${value})) return undefined;\n` +
+          `out += stringify(${value});\n`
+        );
+    }
+    throw new TypeError(`Invalid schema: ${String(schema)}`);
+  }
+
+  generateArray(schema, array) {
+    if (schema.length !== 1) {
+      throw new TypeError('Array schema must contain exactly one item schema');
+    }
+    const index = this.newVariable('i');
+    const item = this.newVariable('v');
+    return (
+      `if (!Array.isArray(${array}) || hasMethods(${array})) ` +
+      'return undefined;\n' +
+      "out += '[';\n" +
+      `for (let ${index} = 0; ${index} < ${array}.length; ${index}++) {\n` +
+      `if (${index} !== 0) out += ',';\n` +
+      `const ${item} = ${array}[${index}];\n` +
+      `if (${item} !== undefined) {\n` +
+      this.generate(schema[0], item) +
+      '}\n' +
+      '}\n' +
+      "out += ']';\n"
+    );
+  }
+
+  generateObject(schema, object) {
+    const separator = this.newVariable('separator');
+    let code =
+      `if (typeof ${object} !== 'object' || ${object} === null || ` +
+      `Object.getPrototypeOf(${object}) !== Object.prototype || ` +
+      `${object}.toMDSF !== undefined || ${object}.toJSON !== undefined) ` +
+      'return undefined;\n' +
+      "out += '{';\n" +
+      `let ${separator} = '';\n`;
+    Object.keys(schema).forEach(key => {
+      const keyText = IDENTIFIER.test(key) ? key : this.stringify(key);
+      const field = this.newVariable('v');
+      code +=
+        `const ${field} = ${object}[${JSON.stringify(key)}];\n` +
+        `if (${field} !== undefined) {\n` +
+        `out += ${separator} + ${JSON.stringify(keyText + ':')};\n` +
+        this.generate(schema[key], field) +
+        `${separator} = ',';\n` +
+        '}\n';
+    });
+    return code + "out += '}';\n";
+  }
+}
+
+// Compile a serializer specialized for values of one shape, which writes
+// object keys precomputed in advance in the order of the schema and checks
+// the type of each value once. Values that don't match the schema are
+// serialized by the generic `stringify`.
+//   schema - the shape of the values, one of:
+//     'string', 'number', 'boolean' - values of these types
+//     'any' - values of any type, serialized by the generic `stringify`
+//     [itemSchema] - arrays of items of the `itemSchema`
+//     { key: fieldSchema, ... } - plain objects without `toMDSF()` and
+//       `toJSON()` methods; only the properties in the schema are written,
+//       properties set to undefined are omitted
+//   stringify - the generic serializer
+//   Returns a function serializing a value into a string
+//
+const compileStringifier = (schema, stringify) => {
+  const generator = new Generator(stringify);
+  const code =
+    "let out = '';\n" +
+    'if (value === undefined) return undefined;\n' +
+    generator.generate(schema, 'value') +
+    'return out;\n';
+  const serialize = new Function(
+    'ESCAPED_CHARACTERS',
+    'hasMethods',
+    'isSerializable',
+    'stringify',
+    `return value => {\n${code}};`
+  )(ESCAPED_CHARACTERS, hasMethods, isSerializable, stringify);
+
+  return value => {
+    const result = serialize(value);
+    return result === undefined ? stringify(value) : result;
+  };
+};
+
+module.exports = compileStringifier;
@@ -2,6 +2,7 @@
 
 const safeRequire = require('./common').safeRequire;
 const stringify = require('./stringify');
+const compileStringifier = require('./compile-stringifier');
 
 let [error, mdsfNative] = safeRequire('../build/Release/mdsf');
 
@@ -11,8 +12,16 @@ if (error) {
 }
 
 if (mdsfNative) {
+  // The native stringify() is only faster on values with long strings, since
+  // walking objects through the V8 API costs more than JIT-compiled code does
   module.exports = Object.assign(Object.create(null), mdsfNative, {
     stringify,
+    nativeStringify: mdsfNative.stringify,
+    compileStringifier: schema => compileStringifier(schema, stringify),
+    compileParser: schema => {
+      const parser = new mdsfNative.SchemaParser(schema);
+      return data => parser.parse(data);
+    },
   });
 } else {
   console.warn(
@@ -1,44 +1,351 @@
 'use strict';
 
+/* global TextDecoder */
+
 const stringify = require('./stringify');
+const compileStringifier = require('./compile-stringifier');
+
+// Maximal nesting depth of arrays and objects accepted by default
+//
+const DEFAULT_MAX_DEPTH = 1000;
+
+// Find the first invalid UTF-8 sequence in a Buffer, i.e. an overlong
+// form, a surrogate, a code point above U+10FFFF or a truncated sequence
+//   buffer - Buffer to check
+//   Returns the offset of the sequence or -1 if the buffer is valid UTF-8
+//
+const findInvalidUtf8 = buffer => {
+  let offset = 0;
+  while (offset < buffer.length) {
+    const lead = buffer[offset];
+    if (lead < 0x80) {
+      offset++;
+      continue;
+    }
+    let size;
+    let min = 0x80;
+    let max = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+      size = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+      size = 3;
+      if (lead === 0xe0) min = 0xa0;
+      else if (lead === 0xed) max = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+      size = 4;
+      if (lead === 0xf0) min = 0x90;
+      else if (lead === 0xf4) max = 0x8f;
+    } else {
+      return offset;
+    }
+    const second = buffer[offset + 1];
+    if (offset + size > buffer.length || second < min || second > max) {
+      return offset;
+    }
+    for (let i = 2; i < size; i++) {
+      if ((buffer[offset + i] & 0xc0) !== 0x80) return offset;
+    }
+    offset += size;
+  }
+  return -1;
+};
 
 // Deserialize a string into a JavaScript value and return it.
 //   data - a string or Buffer to parse
-//
-const parse = data => {
+//   options - optional object:
+//     maxDepth - maximal nesting depth of arrays and objects, 1000 by default
+//     externalStrings - only used by the native parser, create long ASCII
+//       strings outside of the JavaScript heap, each from a copy of its own
+//     validateUtf8 - throw a SyntaxError with the offset of the first
+//       invalid sequence as its `offset` property if a Buffer is not valid
+//       UTF-8 instead of replacing the invalid sequences with U+FFFD
+//
+const parse = (data, options) => {
   if (Buffer.isBuffer(data)) {
+    if (options && options.validateUtf8) {
+      const offset = findInvalidUtf8(data);
+      if (offset !== -1) {
+        const error = new SyntaxError('Invalid UTF-8 sequence');
+        error.offset = offset;
+        throw error;
+      }
+    }
     data = data.toString();
   }
 
-  const parser = new Parser(data);
+  const maxDepth =
+    options && options.maxDepth !== undefined
+      ? options.maxDepth
+      : DEFAULT_MAX_DEPTH;
+  const parser = new Parser(data, maxDepth);
   return parser.parse();
 };
 
+// Deserialize a string into a JavaScript value asynchronously.
+//   data - a string or Buffer to parse
+//   options - optional object, the same as for parse()
+//   Returns a promise resolved with the value or rejected with the parsing
+//   error
+//
+const parseAsync = (data, options) =>
+  new Promise(resolve => resolve(parse(data, options)));
+
+// Parse a single JSTP network message without the terminator.
+//   data - message contents
+//
+const parseJSTPMessage = data => {
+  const parser = new Parser(data);
+  const message = parser.parseObject();
+  parser.ensureEndOfData();
+  return message;
+};
+
+// Parse JSTP network messages from a Buffer.
+//   data - a Buffer or Uint8Array
+//   messages - target array
+//   offset - offset of the messages in the buffer
+//   Returns the count of bytes taken by the parsed messages
+//
+const parseJSTPMessagesInBuffer = (data, messages, offset) => {
+  if (!Number.isInteger(offset) || offset < 0 || offset > data.length) {
+    throw new RangeError('Offset is out of range');
+  }
+  const buffer = Buffer.from(data.buffer, data.byteOffset, data.length);
+  const end = buffer.lastIndexOf(0);
+  if (end < offset) {
+    return 0;
+  }
+
+  const chunks = buffer.toString('utf8', offset, end).split('\u0000');
+  for (let i = 0; i < chunks.length; i++) {
+    messages.push(parseJSTPMessage(chunks[i]));
+  }
+  return end + 1 - offset;
+};
+
 // Parse a buffer of JSTP network messages.
-//   data - buffer contents
+//   data - buffer contents, a string or Buffer
 //   messages - target array
-//   Returns the part of the message that has not been received yet
+//   offset - optional offset of the messages in a Buffer
+//   Returns the part of the message that has not been received yet for
+//   strings or the count of bytes taken by the parsed messages for Buffers
 //
-const parseJSTPMessages = (data, messages) => {
+const parseJSTPMessages = (data, messages, offset = 0) => {
+  if (typeof data !== 'string') {
+    return parseJSTPMessagesInBuffer(data, messages, offset);
+  }
+
   const chunks = data.split('\u0000');
   const readyMessagesCount = chunks.length - 1;
 
   for (let i = 0; i < readyMessagesCount; i++) {
-    const parser = new Parser(chunks[i]);
-    const message = parser.parseObject();
-    parser.ensureEndOfData();
-    messages.push(message);
+    messages.push(parseJSTPMessage(chunks[i]));
   }
 
   return chunks[readyMessagesCount];
 };
 
+// Serialize a value into UTF-8 bytes the same way as stringify() does
+// without a replacer and indentation.
+//   value - a value to serialize
+//   target - optional Buffer or Uint8Array to write the bytes into
+//   offset - optional offset in the target, 0 by default
+//   Returns a Buffer viewing the bytes written into the target if they fit
+//   there, or a new Buffer containing them otherwise, in which case the
+//   native serializer leaves the part of them that fits written into the
+//   target
+//
+const stringifyToBuffer = (value, target, offset = 0) => {
+  const data = stringify(value);
+  if (target === undefined) {
+    return Buffer.from(data);
+  }
+  if (!Number.isInteger(offset) || offset < 0 || offset > target.length) {
+    throw new RangeError('Offset is out of range');
+  }
+  const length = Buffer.byteLength(data);
+  if (length > target.length - offset) {
+    return Buffer.from(data);
+  }
+  const result = Buffer.from(
+    target.buffer,
+    target.byteOffset + offset,
+    length
+  );
+  result.write(data);
+  return result;
+};
+
+// Maximal length of a number converted to a string
+//
+const MAX_NUMBER_LENGTH = 24;
+
+// Estimate the size in bytes of the output of stringifyToBuffer() without
+// serializing the value. Methods of objects are not called, escape sequences
+// are not taken into account and numbers other than integers are counted as
+// the longest ones.
+//   value - a value to estimate the size of
+//   depth - nesting depth of the value
+//
+const estimateSize = (value, depth = 0) => {
+  switch (typeof value) {
+    case 'string':
+      return Buffer.byteLength(value) + 2;
+    case 'number':
+      return Number.isSafeInteger(value)
+        ? String(value).length
+        : MAX_NUMBER_LENGTH;
+    case 'boolean':
+      return 5;
+    case 'undefined':
+      return 9;
+    case 'object':
+      break;
+    default:
+      return 0;
+  }
+  if (value === null) {
+    return 4;
+  }
+  if (Buffer.isBuffer(value)) {
+    return Math.floor((value.length + 2) / 3) * 4 + 2;
+  }
+  if (value instanceof String) {
+    return estimateSize(value.valueOf(), depth);
+  }
+  if (value instanceof Number) {
+    return MAX_NUMBER_LENGTH;
+  }
+  if (value instanceof Boolean) {
+    return 5;
+  }
+  if (depth === DEFAULT_MAX_DEPTH) {
+    throw new RangeError('Maximum nesting depth exceeded');
+  }
+
+  if (Array.isArray(value)) {
+    let size = value.length > 0 ? value.length + 1 : 2;
+    for (let i = 0; i < value.length; i++) {
+      if (value[i] !== undefined) {
+        size += estimateSize(value[i], depth + 1);
+      }
+    }
+    return size;
+  }
+  const keys = Object.keys(value);
+  let size = keys.length > 0 ? keys.length + 1 : 2;
+  for (let i = 0; i < keys.length; i++) {
+    const key = keys[i];
+    size += estimateSize(key) + estimateSize(value[key], depth + 1);
+  }
+  return size;
+};
+
+const SCALAR_SCHEMAS = ['string', 'number', 'boolean', 'any'];
+
+// Check that a schema is valid the same way as the native parser does
+//   schema - the schema passed to compileParser()
+//   depth - nesting depth of the schema
+//
+const checkSchema = (schema, depth = 0) => {
+  if (depth === DEFAULT_MAX_DEPTH) {
+    throw new RangeError('Maximum nesting depth exceeded');
+  }
+  if (typeof schema === 'string') {
+    if (!SCALAR_SCHEMAS.includes(schema)) {
+      throw new TypeError('Invalid schema');
+    }
+  } else if (Array.isArray(schema)) {
+    if (schema.length !== 1) {
+      throw new TypeError('Array schema must contain exactly one item schema');
+    }
+    checkSchema(schema[0], depth + 1);
+  } else if (typeof schema === 'object' && schema !== null) {
+    Object.keys(schema).forEach(key => {
+      checkSchema(schema[key], depth + 1);
+      if (/^\d/.test(key) || key === '__proto__') {
+        throw new TypeError('Invalid key in schema');
+      }
+    });
+  } else {
+    throw new TypeError('Invalid schema');
+  }
+};
+
+// Compile a parser of values of a known layout. The native parser compares
+// the keys of objects found in the order of the schema with the expected
+// ones byte by byte and creates the objects matching the schema entirely
+// with a layout built in advance, while the rest of the values are parsed as
+// usual. Types of scalar values only document the schema and are not checked.
+//   schema - the layout of the values, one of:
+//     'string', 'number', 'boolean', 'any' - values of any layout
+//     [itemSchema] - arrays of items of the `itemSchema`
+//     { key: fieldSchema, ... } - objects with these keys in this order,
+//       which must not start with a digit and must not be `__proto__`
+//   Returns a function parsing a string or Buffer into a value
+//
+const compileParser = schema => {
+  checkSchema(schema);
+  return data => parse(data);
+};
+
+// Create a function decoding chunks of UTF-8 bytes into strings, which keeps
+// the bytes of a character split between chunks until the next one. The
+// global TextDecoder of browsers and Node.js 11+ is preferred, so that the
+// browser build does not depend on Node.js core modules
+//
+const createUtf8Decoder = () => {
+  if (typeof TextDecoder === 'function') {
+    const decoder = new TextDecoder();
+    return chunk => decoder.decode(chunk, { stream: true });
+  }
+  const { StringDecoder } = require('string_decoder');
+  const decoder = new StringDecoder('utf8');
+  return chunk => decoder.write(chunk);
+};
+
+// Parser of JSTP network messages arriving in chunks, which keeps the part
+// of the message that has not been received yet between calls
+//
+function StreamParser() {
+  this.pending = '';
+  this.decoder = null;
+}
+
+// Parse the messages completed by a chunk of data. If a message can not be
+// parsed, the data that has not been parsed yet is discarded.
+//   data - a string or Buffer
+//   messages - target array
+//
+StreamParser.prototype.write = function(data, messages) {
+  if (typeof data !== 'string') {
+    if (!this.decoder) {
+      this.decoder = createUtf8Decoder();
+    }
+    data = this.decoder(data);
+  }
+
+  let start = 0;
+  let end = data.indexOf('\u0000');
+  while (end !== -1) {
+    const message = this.pending + data.slice(start, end);
+    this.pending = '';
+    start = end + 1;
+    messages.push(parseJSTPMessage(message));
+    end = data.indexOf('\u0000', start);
+  }
+  this.pending += data.slice(start);
+};
+
 // Internal parser class
 //   string - a string to parse
+//   maxDepth - maximal nesting depth of arrays and objects
 //
-function Parser(string) {
+function Parser(string, maxDepth = DEFAULT_MAX_DEPTH) {
   this.string = string;
   this.lookaheadIndex = 0;
+  this.maxDepth = maxDepth;
+  this.depth = 0;
 }
 
 // Start parsing
@@ -606,10 +913,21 @@ Parser.prototype.parseEs6UnicodeLiteral = function() {
   return String.fromCodePoint(code);
 };
 
+// Enter an array or an object ensuring that the maximal nesting depth is
+// not exceeded
+//
+Parser.prototype.enterContainer = function() {
+  if (this.depth >= this.maxDepth) {
+    this.throwError('Maximum nesting depth exceeded');
+  }
+  this.depth++;
+};
+
 // Parse an array
 //
 Parser.prototype.parseArray = function() {
   this.skipClutter();
+  this.enterContainer();
   this.match('[');
 
   const array = [];
@@ -633,6 +951,7 @@ Parser.prototype.parseArray = function() {
   }
 
   this.match(']');
+  this.depth--;
 
   return array;
 };
@@ -644,6 +963,7 @@ Parser.prototype.parseObject = function() {
 
   const object = {};
 
+  this.enterContainer();
   this.match('{');
 
   while (this.lookahead() !== '}') {
@@ -664,6 +984,7 @@ Parser.prototype.parseObject = function() {
 
   this.skipClutter();
   this.match('}');
+  this.depth--;
 
   return object;
 };
@@ -691,6 +1012,12 @@ Parser.prototype.parseObjectKey = function() {
 
 module.exports = {
   stringify,
+  stringifyToBuffer,
+  estimateSize: value => estimateSize(value),
+  compileStringifier: schema => compileStringifier(schema, stringify),
+  compileParser,
   parse,
+  parseAsync,
   parseJSTPMessages,
+  StreamParser,
 };
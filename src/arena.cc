@@ -0,0 +1,53 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "arena.h"
+
+#include <cstddef>
+#include <memory>
+
+using std::size_t;
+using std::unique_ptr;
+
+namespace mdsf {
+
+const size_t Arena::kChunkSize;
+
+Arena::Arena() : current_(nullptr), remaining_(0) {}
+
+char* Arena::Allocate(size_t size) {
+  if (size > remaining_) {
+    // Large blocks get chunks of their own, so that the rest of the current
+    // chunk is not wasted.
+    if (size > kChunkSize) {
+      large_chunks_.push_back(unique_ptr<char[]>(new char[size]));
+      return large_chunks_.back().get();
+    }
+    chunks_.push_back(unique_ptr<char[]>(new char[kChunkSize]));
+    current_ = chunks_.back().get();
+    remaining_ = kChunkSize;
+  }
+  char* result = current_;
+  current_ += size;
+  remaining_ -= size;
+  return result;
+}
+
+void Arena::Shrink(char* data, size_t allocated_size, size_t size) {
+  if (data + allocated_size == current_) {
+    current_ = data + size;
+    remaining_ += allocated_size - size;
+  }
+}
+
+void Arena::Reset() {
+  large_chunks_.clear();
+  if (chunks_.empty()) {
+    return;
+  }
+  chunks_.resize(1);
+  current_ = chunks_.front().get();
+  remaining_ = kChunkSize;
+}
+
+}  // namespace mdsf
@@ -0,0 +1,48 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_ARENA_H_
+#define SRC_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mdsf {
+
+// A bump allocator handing out memory from large chunks, all of which is
+// released at once when the arena is reset or destroyed. Pointers returned
+// by Allocate() stay valid until then. A single chunk is kept over resets,
+// so that an arena reused between parses doesn't allocate at all as long as
+// their temporary data fits into it.
+class Arena {
+ public:
+  Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns a pointer to `size` bytes of uninitialized memory.
+  char* Allocate(std::size_t size);
+
+  // Gives the memory past the first `size` bytes of the block `data` of
+  // `allocated_size` bytes back to the arena if it is the most recently
+  // allocated one.
+  void Shrink(char* data, std::size_t allocated_size, std::size_t size);
+
+  // Releases all of the memory allocated from the arena.
+  void Reset();
+
+ private:
+  static const std::size_t kChunkSize = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  // Chunks of single blocks larger than kChunkSize, which are never reused.
+  std::vector<std::unique_ptr<char[]>> large_chunks_;
+  char* current_;
+  std::size_t remaining_;
+};
+
+}  // namespace mdsf
+
+#endif  // SRC_ARENA_H_
@@ -0,0 +1,176 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "async_parser.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include <node.h>
+#include <uv.h>
+#include <v8.h>
+
+#include "common.h"
+#include "parser.h"
+#include "tape.h"
+
+using std::memcpy;
+using std::size_t;
+using std::unique_ptr;
+
+using v8::Context;
+using v8::Global;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::MaybeLocal;
+using v8::Object;
+using v8::Promise;
+using v8::TryCatch;
+using v8::Value;
+
+using mdsf::parser::internal::CreateError;
+using mdsf::parser::internal::CreateValue;
+
+namespace mdsf {
+
+namespace async_parser {
+
+namespace {
+
+// State of a single ParseAsync() call shared between the main thread and
+// the thread pool.
+struct ParseRequest {
+  uv_work_t work;
+  Isolate* isolate;
+  Global<Context> context;
+  Global<Promise::Resolver> resolver;
+#if NODE_MODULE_VERSION >= 64
+  Global<Object> async_resource;
+  node::async_context async_context;
+#endif
+
+  // A copy of the input, so that the caller is free to modify the original
+  // one, which the tape refers to. It is terminated by a null character
+  // like the strings the synchronous parser is given.
+  unique_ptr<char[]> input;
+  size_t length;
+  parser::Options options;
+
+  tape::Tape tape;
+  tape::Error error;
+  bool is_ok;
+};
+
+}  // namespace
+
+// Builds the tape of the request, runs on the thread pool.
+static void ParseInThreadPool(uv_work_t* work) {
+  ParseRequest* request = static_cast<ParseRequest*>(work->data);
+  const char* input = request->input.get();
+  request->is_ok = tape::Parse(input, input + request->length,
+                               &request->tape, &request->error,
+                               request->options.max_depth, nullptr,
+                               request->options.validate_utf8);
+}
+
+// Resolves the promise of the request with the value created from its tape
+// or rejects it with the parsing error.
+static void SettlePromise(Isolate* isolate,
+                          Local<Context> context,
+                          ParseRequest* request) {
+  Local<Promise::Resolver> resolver =
+      Local<Promise::Resolver>::New(isolate, request->resolver);
+
+  if (!request->is_ok) {
+    resolver->Reject(context, CreateError(isolate, request->error))
+        .FromMaybe(false);
+    return;
+  }
+
+  TryCatch try_catch(isolate);
+  size_t position = 0;
+  Local<Value> result;
+  if (CreateValue(isolate, request->tape, &position, request->options)
+          .ToLocal(&result)) {
+    resolver->Resolve(context, result).FromMaybe(false);
+  } else if (try_catch.HasCaught()) {
+    resolver->Reject(context, try_catch.Exception()).FromMaybe(false);
+  }
+}
+
+// Settles the promise of the request, runs on the main thread.
+static void AfterParse(uv_work_t* work, int status) {
+  unique_ptr<ParseRequest> request(static_cast<ParseRequest*>(work->data));
+  Isolate* isolate = request->isolate;
+
+  HandleScope scope(isolate);
+  Local<Context> context = Local<Context>::New(isolate, request->context);
+  Context::Scope context_scope(context);
+
+#if NODE_MODULE_VERSION >= 64
+  {
+    // Runs the microtasks queued by settling the promise once it is closed.
+    node::CallbackScope callback_scope(
+        isolate, Local<Object>::New(isolate, request->async_resource),
+        request->async_context);
+    SettlePromise(isolate, context, request.get());
+  }
+  node::EmitAsyncDestroy(isolate, request->async_context);
+#else
+  SettlePromise(isolate, context, request.get());
+  isolate->RunMicrotasks();
+#endif
+}
+
+MaybeLocal<Promise> ParseAsync(Isolate*               isolate,
+                               const char*            str,
+                               size_t                 length,
+                               const parser::Options& options) {
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Promise::Resolver> resolver;
+  if (!Promise::Resolver::New(context).ToLocal(&resolver)) {
+    return MaybeLocal<Promise>();
+  }
+
+  unique_ptr<ParseRequest> request(new ParseRequest());
+  request->work.data = request.get();
+  request->isolate = isolate;
+  request->context.Reset(isolate, context);
+  request->resolver.Reset(isolate, resolver);
+#if NODE_MODULE_VERSION >= 64
+  Local<Object> async_resource = Object::New(isolate);
+  request->async_resource.Reset(isolate, async_resource);
+  request->async_context =
+      node::EmitAsyncInit(isolate, async_resource, "mdsf:parseAsync");
+#endif
+  request->input.reset(new char[length + 1]);
+  memcpy(request->input.get(), str, length);
+  request->input[length] = '\0';
+  request->length = length;
+  request->options = options;
+
+#if NODE_MODULE_VERSION >= 64
+  uv_loop_t* loop = node::GetCurrentEventLoop(isolate);
+#else
+  uv_loop_t* loop = uv_default_loop();
+#endif
+  int status = uv_queue_work(loop, &request->work, ParseInThreadPool,
+                             AfterParse);
+  if (status != 0) {
+#if NODE_MODULE_VERSION >= 64
+    node::EmitAsyncDestroy(isolate, request->async_context);
+#endif
+    THROW_EXCEPTION(Error, uv_strerror(status));
+    return MaybeLocal<Promise>();
+  }
+
+  // The request is owned by AfterParse() from now on.
+  request.release();
+  return resolver->GetPromise();
+}
+
+}  // namespace async_parser
+
+}  // namespace mdsf
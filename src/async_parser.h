@@ -0,0 +1,32 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_ASYNC_PARSER_H_
+#define SRC_ASYNC_PARSER_H_
+
+#include <cstddef>
+
+#include <v8.h>
+
+#include "parser.h"
+
+namespace mdsf {
+
+namespace async_parser {
+
+// Deserializes a UTF-8 encoded string into a JavaScript value without
+// blocking the event loop. The input is copied and parsed into a tape on
+// the libuv thread pool, only the JavaScript value is created on the main
+// thread. Returns a promise resolved with the value or rejected with the
+// parsing error. The `options` are the same as those of parser::Parse().
+v8::MaybeLocal<v8::Promise> ParseAsync(
+    v8::Isolate*           isolate,
+    const char*            str,
+    std::size_t            length,
+    const parser::Options& options = parser::Options());
+
+}  // namespace async_parser
+
+}  // namespace mdsf
+
+#endif  // SRC_ASYNC_PARSER_H_
@@ -19,4 +19,16 @@ inline v8::Local<v8::String> NewFromUtf8OrEmpty(
       .FromMaybe(v8::String::Empty(isolate));
 }
 
+// Creates a string from `data` without decoding it, which is only correct if
+// it consists of ASCII characters.
+inline v8::Local<v8::String> NewFromOneByteOrEmpty(
+    v8::Isolate *isolate,
+    const char *data,
+    v8::NewStringType type = v8::NewStringType::kNormal,
+    int length = -1) {
+  return v8::String::NewFromOneByte(
+             isolate, reinterpret_cast<const uint8_t *>(data), type, length)
+      .FromMaybe(v8::String::Empty(isolate));
+}
+
 #endif  // SRC_COMMON_H_
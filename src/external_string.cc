@@ -0,0 +1,60 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "external_string.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include <v8.h>
+
+using std::memcpy;
+using std::size_t;
+using std::unique_ptr;
+
+using v8::Isolate;
+using v8::Local;
+using v8::String;
+
+namespace mdsf {
+
+namespace external_string {
+
+namespace {
+
+// A string resource owning a copy of the characters, which V8 deletes when
+// the string is collected. The copy is exactly as large as the string, so
+// that V8 accounts for all of the memory the string keeps alive.
+class CopiedResource : public String::ExternalOneByteStringResource {
+ public:
+  CopiedResource(const char* data, size_t length)
+      : data_(new char[length]), length_(length) {
+    memcpy(data_.get(), data, length);
+  }
+
+  const char* data() const override { return data_.get(); }
+  size_t length() const override { return length_; }
+
+ private:
+  unique_ptr<char[]> data_;
+  size_t length_;
+};
+
+}  // namespace
+
+Local<String> NewExternalOneByte(Isolate*    isolate,
+                                 const char* data,
+                                 size_t      length) {
+  CopiedResource* resource = new CopiedResource(data, length);
+  Local<String> result;
+  if (!String::NewExternalOneByte(isolate, resource).ToLocal(&result)) {
+    delete resource;
+    return String::Empty(isolate);
+  }
+  return result;
+}
+
+}  // namespace external_string
+
+}  // namespace mdsf
@@ -0,0 +1,27 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_EXTERNAL_STRING_H_
+#define SRC_EXTERNAL_STRING_H_
+
+#include <cstddef>
+
+#include <v8.h>
+
+namespace mdsf {
+
+namespace external_string {
+
+// Creates a string of `length` ASCII characters copied from `data` into
+// memory of its own outside of the JavaScript heap, which is released once
+// the string is garbage collected. Returns an empty string if the string is
+// too long.
+v8::Local<v8::String> NewExternalOneByte(v8::Isolate* isolate,
+                                         const char*  data,
+                                         std::size_t  length);
+
+}  // namespace external_string
+
+}  // namespace mdsf
+
+#endif  // SRC_EXTERNAL_STRING_H_
@@ -0,0 +1,121 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "isolate_data.h"
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <node.h>
+#include <v8.h>
+
+using std::lock_guard;
+using std::mutex;
+using std::size_t;
+using std::unordered_map;
+using std::vector;
+
+using v8::Isolate;
+
+namespace mdsf {
+
+namespace isolate_data {
+
+// Data of all of the isolates, which may live on different threads. The map
+// is never destroyed, so that it outlives the cleanup hooks run at exit.
+static mutex data_mutex;
+static unordered_map<Isolate*, IsolateData*>* all_data =
+    new unordered_map<Isolate*, IsolateData*>();
+
+// The isolate last looked up on the current thread and its data, which spare
+// the lock and the map lookup on the following calls from the same isolate.
+static thread_local Isolate* last_isolate = nullptr;
+static thread_local IsolateData* last_data = nullptr;
+
+#if NODE_MODULE_VERSION >= 64
+static void Dispose(void* arg) {
+  Isolate* isolate = static_cast<Isolate*>(arg);
+  IsolateData* data;
+  {
+    lock_guard<mutex> lock(data_mutex);
+    auto it = all_data->find(isolate);
+    data = it->second;
+    all_data->erase(it);
+  }
+  if (last_isolate == isolate) {
+    last_isolate = nullptr;
+    last_data = nullptr;
+  }
+  delete data;
+}
+#endif
+
+IsolateData* Get(Isolate* isolate) {
+  if (last_isolate == isolate) {
+    return last_data;
+  }
+
+  IsolateData* data = nullptr;
+  {
+    lock_guard<mutex> lock(data_mutex);
+    auto it = all_data->find(isolate);
+    if (it != all_data->end()) {
+      data = it->second;
+    }
+  }
+
+  if (data == nullptr) {
+    data = new IsolateData();
+    {
+      lock_guard<mutex> lock(data_mutex);
+      (*all_data)[isolate] = data;
+    }
+#if NODE_MODULE_VERSION >= 64
+    node::AddEnvironmentCleanupHook(isolate, Dispose, isolate);
+#endif
+    // Older versions of Node.js only run a single isolate, whose data lives
+    // as long as the process.
+  }
+
+  last_isolate = isolate;
+  last_data = data;
+  return data;
+}
+
+// Vectors of the shared tape larger than that are released after a parse
+// rather than kept for the next one.
+static const size_t kMaxRetainedBytes = 1024 * 1024;
+
+// Releases the memory of `vec` if it takes more than kMaxRetainedBytes.
+template <typename T>
+static void TrimVector(vector<T>* vec) {
+  if (vec->capacity() * sizeof(T) > kMaxRetainedBytes) {
+    vector<T>().swap(*vec);
+  }
+}
+
+ScopedTape::ScopedTape(IsolateData* data) : data_(data) {
+  if (data_->is_tape_in_use) {
+    own_tape_.reset(new tape::Tape());
+    tape_ = own_tape_.get();
+  } else {
+    data_->is_tape_in_use = true;
+    tape_ = &data_->tape;
+  }
+}
+
+ScopedTape::~ScopedTape() {
+  if (own_tape_) {
+    return;
+  }
+  TrimVector(&tape_->nodes);
+  TrimVector(&tape_->index.tokens);
+  tape_->arena.Reset();
+  data_->is_tape_in_use = false;
+}
+
+}  // namespace isolate_data
+
+}  // namespace mdsf
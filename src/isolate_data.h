@@ -0,0 +1,72 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_ISOLATE_DATA_H_
+#define SRC_ISOLATE_DATA_H_
+
+#include <memory>
+
+#include <v8.h>
+
+#include "key_cache.h"
+#include "serializer.h"
+#include "shape_cache.h"
+#include "tape.h"
+
+namespace mdsf {
+
+namespace isolate_data {
+
+// State of the parser and the serializer kept between calls, separately for
+// every isolate the addon is used in.
+struct IsolateData {
+  IsolateData() : is_tape_in_use(false) {}
+
+  key_cache::KeyCache key_cache;
+  shape_cache::ShapeCache shape_cache;
+
+  // The tape of the synchronous parsers, which keeps the memory of its
+  // nodes, structural index and arena between calls.
+  tape::Tape tape;
+  bool is_tape_in_use;
+
+  serializer::KeyCache serialized_key_cache;
+
+  // Prototype of Node.js buffers, by which the serializer tells them from
+  // other Uint8Arrays, created on first use.
+  v8::Global<v8::Object> buffer_prototype;
+
+  // Internalized names of the methods the serializer calls, created on first
+  // use.
+  v8::Global<v8::String> to_mdsf_name;
+  v8::Global<v8::String> to_json_name;
+};
+
+// Returns the data of the `isolate`, creating it on first use. It is
+// released together with the Node.js environment of the isolate.
+IsolateData* Get(v8::Isolate* isolate);
+
+// Lends the tape of the isolate data for the lifetime of the object. A parse
+// started from JavaScript called by another one, e.g. by a `__proto__`
+// setter, gets a tape of its own instead.
+class ScopedTape {
+ public:
+  explicit ScopedTape(IsolateData* data);
+  ~ScopedTape();
+
+  ScopedTape(const ScopedTape&) = delete;
+  ScopedTape& operator=(const ScopedTape&) = delete;
+
+  tape::Tape* get() const { return tape_; }
+
+ private:
+  IsolateData* data_;
+  std::unique_ptr<tape::Tape> own_tape_;
+  tape::Tape* tape_;
+};
+
+}  // namespace isolate_data
+
+}  // namespace mdsf
+
+#endif  // SRC_ISOLATE_DATA_H_
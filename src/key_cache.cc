@@ -0,0 +1,95 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "key_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <v8.h>
+
+#include "common.h"
+
+using std::memcmp;
+using std::memcpy;
+using std::size_t;
+using std::uint32_t;
+
+using v8::Isolate;
+using v8::Local;
+using v8::MaybeLocal;
+using v8::NewStringType;
+using v8::String;
+
+namespace mdsf {
+
+namespace key_cache {
+
+const size_t KeyCache::kCapacity;
+const size_t KeyCache::kMaxKeyLength;
+
+// Returns the 32-bit FNV-1a hash of `length` bytes at `str`.
+static uint32_t Hash(const char* str, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<unsigned char>(str[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+KeyCache::KeyCache()
+    : entries_(new Entry[kCapacity]), hits_(0), misses_(0), size_(0) {
+  for (size_t i = 0; i < kCapacity; i++) {
+    entries_[i].hash = 0;
+    entries_[i].length = 0;
+  }
+}
+
+// Creates an internalized string for the key `str` of `length` bytes.
+static Local<String> NewKey(Isolate* isolate,
+                            const char* str,
+                            size_t length,
+                            bool is_ascii) {
+  if (is_ascii) {
+    return NewFromOneByteOrEmpty(isolate, str, NewStringType::kInternalized,
+                                 static_cast<int>(length));
+  }
+  return NewFromUtf8OrEmpty(isolate, str, NewStringType::kInternalized,
+                            static_cast<int>(length));
+}
+
+MaybeLocal<String> KeyCache::Get(Isolate* isolate,
+                                 const char* str,
+                                 size_t length,
+                                 bool is_ascii) {
+  if (length > kMaxKeyLength) {
+    misses_++;
+    return NewKey(isolate, str, length, is_ascii);
+  }
+
+  const uint32_t hash = Hash(str, length);
+  Entry& entry = entries_[hash & (kCapacity - 1)];
+
+  if (!entry.string.IsEmpty() && entry.hash == hash &&
+      entry.length == length && memcmp(entry.bytes, str, length) == 0) {
+    hits_++;
+    return Local<String>::New(isolate, entry.string);
+  }
+
+  misses_++;
+  Local<String> result = NewKey(isolate, str, length, is_ascii);
+  if (entry.string.IsEmpty()) {
+    size_++;
+  }
+  entry.hash = hash;
+  entry.length = static_cast<uint32_t>(length);
+  memcpy(entry.bytes, str, length);
+  entry.string.Reset(isolate, result);
+  return result;
+}
+
+}  // namespace key_cache
+
+}  // namespace mdsf
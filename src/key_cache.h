@@ -0,0 +1,65 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_KEY_CACHE_H_
+#define SRC_KEY_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <v8.h>
+
+namespace mdsf {
+
+namespace key_cache {
+
+// A bounded cache of internalized strings for object keys, looked up by the
+// raw UTF-8 bytes of the keys. A hit skips both UTF-8 decoding and the lookup
+// in the string table of V8. The cache is direct-mapped, so a new key simply
+// replaces the one it collides with.
+class KeyCache {
+ public:
+  // Count of entries, a power of two.
+  static const std::size_t kCapacity = 1024;
+
+  // Keys longer than that are not cached.
+  static const std::size_t kMaxKeyLength = 48;
+
+  KeyCache();
+
+  KeyCache(const KeyCache&) = delete;
+  KeyCache& operator=(const KeyCache&) = delete;
+
+  // Returns the internalized string for the UTF-8 encoded key `str` of
+  // `length` bytes. Keys known to be ASCII (`is_ascii`) are not decoded.
+  v8::MaybeLocal<v8::String> Get(v8::Isolate* isolate,
+                                 const char* str,
+                                 std::size_t length,
+                                 bool is_ascii = false);
+
+  std::uint64_t hits() const { return hits_; }
+  std::uint64_t misses() const { return misses_; }
+
+  // Returns the count of entries in use.
+  std::size_t size() const { return size_; }
+
+ private:
+  struct Entry {
+    std::uint32_t hash;
+    std::uint32_t length;
+    char bytes[kMaxKeyLength];
+    v8::Global<v8::String> string;
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+  std::size_t size_;
+};
+
+}  // namespace key_cache
+
+}  // namespace mdsf
+
+#endif  // SRC_KEY_CACHE_H_
@@ -11,18 +11,25 @@
 #include <v8.h>
 
 #include "common.h"
+#include "isolate_data.h"
 #include "parser.h"
+#include "tape.h"
 
+using std::memchr;
 using std::size_t;
-using std::strlen;
 
 using v8::Array;
 using v8::Isolate;
 using v8::Local;
+using v8::MaybeLocal;
+using v8::NewStringType;
 using v8::String;
+using v8::Value;
 
-using mdsf::parser::internal::ParseObject;
-using mdsf::parser::internal::SkipToNextToken;
+using mdsf::isolate_data::ScopedTape;
+using mdsf::parser::internal::CreateValue;
+using mdsf::parser::internal::CreateError;
+using mdsf::tape::Tape;
 
 namespace mdsf {
 
@@ -32,49 +39,62 @@ Local<String> ParseJSTPMessages(Isolate* isolate,
                                 const char* str,
                                 size_t length,
                                 Local<Array> out) {
+  size_t parsed_length;
+  if (!ParseJSTPMessages(isolate, str, length, out, &parsed_length)) {
+    return Local<String>();
+  }
+  return NewFromUtf8OrEmpty(isolate, str + parsed_length,
+                            NewStringType::kNormal,
+                            static_cast<int>(length - parsed_length));
+}
+
+bool ParseJSTPMessages(Isolate* isolate,
+                       const char* str,
+                       size_t length,
+                       Local<Array> out,
+                       size_t* parsed_length) {
   auto context = isolate->GetCurrentContext();
   uint32_t out_index = 0;
-  int32_t parsed_length = 0;
-
-  for (size_t i = 0; i < length; i++) {
-    if (str[i] != kMessageTerminator) {
-      continue;
-    }
-    const char* current_message = str + parsed_length;
-    const char* current_message_end = str + i;
-    size_t skipped_size = SkipToNextToken(current_message, current_message_end);
-    size_t parsed_message_size = 0;
-    if (current_message[skipped_size] != '{') {
-      THROW_EXCEPTION(SyntaxError, "Invalid message type");
-      return Local<String>();
+  ScopedTape tape(isolate_data::Get(isolate));
+  const char* end = str + length;
+  *parsed_length = 0;
+
+  while (true) {
+    const char* message = str + *parsed_length;
+    const char* terminator = static_cast<const char*>(
+        memchr(message, kMessageTerminator, end - message));
+    if (!terminator) {
+      break;
     }
-    auto message_object = ParseObject(isolate,
-                                      current_message + skipped_size,
-                                      current_message_end,
-                                      &parsed_message_size);
+    auto message_object =
+        ParseJSTPMessage(isolate, tape.get(), message, terminator);
 
     if (message_object.IsEmpty()) {
-      return Local<String>();
-    }
-
-    parsed_message_size += skipped_size;
-    parsed_message_size += SkipToNextToken(
-        current_message + parsed_message_size, current_message_end);
-
-    if (parsed_message_size != i - parsed_length) {
-      THROW_EXCEPTION(SyntaxError, "Invalid format");
-      return Local<String>();
+      return false;
     }
 
     auto mb = out->Set(context, out_index++, message_object.ToLocalChecked());
     if (!mb.FromMaybe(false)) {
-      return Local<String>();
+      return false;
     }
 
-    parsed_length = i + 1;
+    *parsed_length = terminator + 1 - str;
   }
 
-  return NewFromUtf8OrEmpty(isolate, str + parsed_length);
+  return true;
+}
+
+MaybeLocal<Value> ParseJSTPMessage(Isolate* isolate,
+                                   Tape* tape,
+                                   const char* begin,
+                                   const char* end) {
+  tape::Error error;
+  if (!tape::ParseMessage(begin, end, tape, &error)) {
+    isolate->ThrowException(CreateError(isolate, error));
+    return MaybeLocal<Value>();
+  }
+  size_t position = 0;
+  return CreateValue(isolate, *tape, &position);
 }
 
 }  // namespace message_parser
@@ -10,6 +10,8 @@
 
 #include <v8.h>
 
+#include "tape.h"
+
 namespace mdsf {
 
 namespace message_parser {
@@ -22,6 +24,24 @@ const char kMessageTerminator = '\0';
 v8::Local<v8::String> ParseJSTPMessages(v8::Isolate* isolate,
     const char* str, std::size_t length, v8::Local<v8::Array> out);
 
+// Same as ParseJSTPMessages but writes the count of bytes taken by the
+// parsed messages and their terminators to `parsed_length` instead of
+// creating a string of the rest of the input. Returns false if an exception
+// has been thrown.
+bool ParseJSTPMessages(v8::Isolate* isolate,
+                       const char* str,
+                       std::size_t length,
+                       v8::Local<v8::Array> out,
+                       std::size_t* parsed_length);
+
+// Parses a single JSTP message from `begin` to `end`, which must be followed
+// by a terminator, using the `tape`. Returns an empty handle if an exception
+// has been thrown.
+v8::MaybeLocal<v8::Value> ParseJSTPMessage(v8::Isolate* isolate,
+                                           tape::Tape* tape,
+                                           const char* begin,
+                                           const char* end);
+
 }  // namespace message_parser
 
 }  // namespace mdsf
@@ -3,19 +3,31 @@
 // Copyright (c) 2018 mdsf project authors. Use of this source code is
 // governed by the MIT license that can be found in the LICENSE file.
 
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
 #include <node.h>
 #include <v8.h>
 
+#include "async_parser.h"
 #include "common.h"
+#include "isolate_data.h"
 #include "parser.h"
 #include "message_parser.h"
+#include "schema_parser.h"
+#include "serializer.h"
+#include "stream_parser.h"
 
 using v8::Array;
 using v8::FunctionCallbackInfo;
 using v8::HandleScope;
 using v8::Isolate;
 using v8::Local;
+using v8::MaybeLocal;
+using v8::Number;
 using v8::Object;
+using v8::Promise;
 using v8::String;
 using v8::Value;
 using v8::Uint8Array;
@@ -24,16 +36,84 @@ namespace mdsf {
 
 namespace bindings {
 
+// Reads the options of parsing from the object `value` into `options`.
+// Returns false if an exception has been thrown.
+static bool GetParseOptions(Isolate*               isolate,
+                            Local<Value>           value,
+                            mdsf::parser::Options* options) {
+  if (value->IsUndefined()) {
+    return true;
+  }
+  if (!value->IsObject()) {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return false;
+  }
+
+  auto context = isolate->GetCurrentContext();
+  Local<Value> external_strings;
+  if (!value.As<Object>()
+           ->Get(context, NewFromUtf8OrEmpty(isolate, "externalStrings"))
+           .ToLocal(&external_strings)) {
+    return false;
+  }
+#if NODE_MODULE_VERSION >= 67
+  options->external_strings = external_strings->BooleanValue(isolate);
+#else
+  options->external_strings =
+      external_strings->BooleanValue(context).FromJust();
+#endif
+
+  Local<Value> validate_utf8;
+  if (!value.As<Object>()
+           ->Get(context, NewFromUtf8OrEmpty(isolate, "validateUtf8"))
+           .ToLocal(&validate_utf8)) {
+    return false;
+  }
+#if NODE_MODULE_VERSION >= 67
+  options->validate_utf8 = validate_utf8->BooleanValue(isolate);
+#else
+  options->validate_utf8 = validate_utf8->BooleanValue(context).FromJust();
+#endif
+
+  Local<Value> max_depth;
+  if (!value.As<Object>()
+           ->Get(context, NewFromUtf8OrEmpty(isolate, "maxDepth"))
+           .ToLocal(&max_depth)) {
+    return false;
+  }
+  if (!max_depth->IsUndefined()) {
+    if (!max_depth->IsNumber()) {
+      THROW_EXCEPTION(TypeError, "Wrong argument type");
+      return false;
+    }
+    const double depth = max_depth.As<Number>()->Value();
+    if (!(depth >= 0) || depth != std::floor(depth)) {
+      THROW_EXCEPTION(RangeError, "maxDepth must be a non-negative integer");
+      return false;
+    }
+    options->max_depth =
+        depth < static_cast<double>(std::numeric_limits<std::size_t>::max()) ?
+            static_cast<std::size_t>(depth) :
+            std::numeric_limits<std::size_t>::max();
+  }
+  return true;
+}
+
 void Parse(const FunctionCallbackInfo<Value>& args) {
   Isolate* isolate = args.GetIsolate();
 
-  if (args.Length() != 1) {
+  if (args.Length() != 1 && args.Length() != 2) {
     THROW_EXCEPTION(TypeError, "Wrong number of arguments");
     return;
   }
 
   HandleScope scope(isolate);
 
+  mdsf::parser::Options options;
+  if (!GetParseOptions(isolate, args[1], &options)) {
+    return;
+  }
+
   Local<Value> result;
   std::size_t length;
 
@@ -45,13 +125,16 @@ void Parse(const FunctionCallbackInfo<Value>& args) {
         args[0]
     );
     length = str.length();
-    result = mdsf::parser::Parse(isolate, *str, length);
+    // Only buffers may contain invalid UTF-8 coming from the outside, while
+    // lone surrogates of strings are encoded by V8 as surrogate code points.
+    options.validate_utf8 = false;
+    result = mdsf::parser::Parse(isolate, *str, length, options);
   } else if (args[0]->IsUint8Array()) {
     Local<Uint8Array> buf = args[0].As<Uint8Array>();
     length = buf->ByteLength();
     void* data = buf->Buffer()->GetContents().Data();
     const char* str = static_cast<const char*>(data) + buf->ByteOffset();
-    result = mdsf::parser::Parse(isolate, str, length);
+    result = mdsf::parser::Parse(isolate, str, length, options);
   } else {
     THROW_EXCEPTION(TypeError, "Wrong argument type");
     return;
@@ -60,20 +143,118 @@ void Parse(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(result);
 }
 
+void ParseAsync(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() != 1 && args.Length() != 2) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+
+  HandleScope scope(isolate);
+
+  mdsf::parser::Options options;
+  if (!GetParseOptions(isolate, args[1], &options)) {
+    return;
+  }
+
+  MaybeLocal<Promise> result;
+
+  if (args[0]->IsString()) {
+    String::Utf8Value str(
+#if NODE_MODULE_VERSION >= 57
+        isolate,
+#endif
+        args[0]
+    );
+    options.validate_utf8 = false;
+    result = mdsf::async_parser::ParseAsync(isolate, *str, str.length(),
+                                            options);
+  } else if (args[0]->IsUint8Array()) {
+    Local<Uint8Array> buf = args[0].As<Uint8Array>();
+    void* data = buf->Buffer()->GetContents().Data();
+    const char* str = static_cast<const char*>(data) + buf->ByteOffset();
+    result = mdsf::async_parser::ParseAsync(isolate, str, buf->ByteLength(),
+                                            options);
+  } else {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return;
+  }
+
+  if (!result.IsEmpty()) {
+    args.GetReturnValue().Set(result.ToLocalChecked());
+  }
+}
+
+// Reads an optional offset into a buffer of `length` bytes from `value` into
+// `offset`. Returns false if an exception has been thrown.
+static bool GetOffset(Isolate*     isolate,
+                      Local<Value> value,
+                      std::size_t  length,
+                      std::size_t* offset) {
+  if (value->IsUndefined()) {
+    return true;
+  }
+  if (!value->IsNumber()) {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return false;
+  }
+  const double number = value.As<Number>()->Value();
+  if (!(number >= 0 && number <= length) || number != std::floor(number)) {
+    THROW_EXCEPTION(RangeError, "Offset is out of range");
+    return false;
+  }
+  *offset = static_cast<std::size_t>(number);
+  return true;
+}
+
+// Parses the messages of the Uint8Array `args[0]` starting at the offset
+// `args[2]` into the array `args[1]` and returns the count of bytes they take.
+static void ParseJSTPMessagesInBuffer(
+    const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<Uint8Array> buf = args[0].As<Uint8Array>();
+  const std::size_t length = buf->ByteLength();
+
+  std::size_t offset = 0;
+  if (!GetOffset(isolate, args[2], length, &offset)) {
+    return;
+  }
+
+  void* data = buf->Buffer()->GetContents().Data();
+  const char* str = static_cast<const char*>(data) + buf->ByteOffset();
+  std::size_t parsed_length;
+  if (mdsf::message_parser::ParseJSTPMessages(isolate, str + offset,
+                                              length - offset,
+                                              args[1].As<Array>(),
+                                              &parsed_length)) {
+    args.GetReturnValue().Set(static_cast<double>(parsed_length));
+  }
+}
+
 void ParseJSTPMessages(const FunctionCallbackInfo<Value>& args) {
   Isolate* isolate = args.GetIsolate();
 
-  if (args.Length() != 2) {
+  if (args.Length() != 2 && args.Length() != 3) {
     THROW_EXCEPTION(TypeError, "Wrong number of arguments");
     return;
   }
-  if (!args[0]->IsString() || !args[1]->IsArray()) {
+  if (!args[1]->IsArray()) {
     THROW_EXCEPTION(TypeError, "Wrong argument type");
     return;
   }
 
   HandleScope scope(isolate);
 
+  if (args[0]->IsUint8Array()) {
+    ParseJSTPMessagesInBuffer(args);
+    return;
+  }
+  if (!args[0]->IsString() || args.Length() != 2) {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return;
+  }
+
   String::Utf8Value str(
 #if NODE_MODULE_VERSION >= 57
       isolate,
@@ -87,9 +268,100 @@ void ParseJSTPMessages(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(result);
 }
 
+void Stringify(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  HandleScope scope(isolate);
+
+  Local<String> result;
+  if (mdsf::serializer::Stringify(isolate, args[0], args[1], args[2])
+          .ToLocal(&result)) {
+    args.GetReturnValue().Set(result);
+  }
+}
+
+void StringifyToBuffer(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() < 1 || args.Length() > 3) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+
+  HandleScope scope(isolate);
+
+  Local<Uint8Array> target;
+  std::size_t offset = 0;
+  if (!args[1]->IsUndefined()) {
+    if (!args[1]->IsUint8Array()) {
+      THROW_EXCEPTION(TypeError, "Wrong argument type");
+      return;
+    }
+    target = args[1].As<Uint8Array>();
+    if (!GetOffset(isolate, args[2], target->ByteLength(), &offset)) {
+      return;
+    }
+  }
+
+  Local<Object> result;
+  if (mdsf::serializer::StringifyToBuffer(isolate, args[0], target, offset)
+          .ToLocal(&result)) {
+    args.GetReturnValue().Set(result);
+  }
+}
+
+void EstimateSize(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() != 1) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+
+  HandleScope scope(isolate);
+
+  std::size_t size;
+  if (mdsf::serializer::EstimateSize(isolate, args[0]).To(&size)) {
+    args.GetReturnValue().Set(static_cast<double>(size));
+  }
+}
+
+void GetKeyCacheStats(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  HandleScope scope(isolate);
+
+  auto context = isolate->GetCurrentContext();
+  const auto& cache = mdsf::isolate_data::Get(isolate)->key_cache;
+  const double hits = static_cast<double>(cache.hits());
+  const double misses = static_cast<double>(cache.misses());
+  const double lookups = hits + misses;
+
+  auto result = Object::New(isolate);
+  auto set = [&](const char* name, double value) {
+    return result->CreateDataProperty(context,
+                                      NewFromUtf8OrEmpty(isolate, name),
+                                      Number::New(isolate, value));
+  };
+  if (set("hits", hits).IsNothing() ||
+      set("misses", misses).IsNothing() ||
+      set("hitRate", lookups > 0 ? hits / lookups : 0).IsNothing() ||
+      set("size", static_cast<double>(cache.size())).IsNothing() ||
+      set("capacity", static_cast<double>(cache.kCapacity)).IsNothing()) {
+    return;
+  }
+
+  args.GetReturnValue().Set(result);
+}
+
 void Init(Local<Object> target) {
   NODE_SET_METHOD(target, "parse", Parse);
+  NODE_SET_METHOD(target, "parseAsync", ParseAsync);
   NODE_SET_METHOD(target, "parseJSTPMessages", ParseJSTPMessages);
+  NODE_SET_METHOD(target, "stringify", Stringify);
+  NODE_SET_METHOD(target, "stringifyToBuffer", StringifyToBuffer);
+  NODE_SET_METHOD(target, "estimateSize", EstimateSize);
+  NODE_SET_METHOD(target, "getKeyCacheStats", GetKeyCacheStats);
+  mdsf::stream_parser::StreamParser::Init(target);
+  mdsf::schema_parser::SchemaParser::Init(target);
 }
 
 NODE_MODULE(mdsf, Init);
@@ -0,0 +1,608 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "number_parser.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "number_tables.h"
+
+using std::int32_t;
+using std::int64_t;
+using std::ldexp;
+using std::memcmp;
+using std::memcpy;
+using std::numeric_limits;
+using std::ptrdiff_t;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+namespace mdsf {
+
+namespace number_parser {
+
+namespace {
+
+struct UInt128 {
+  uint64_t high;
+  uint64_t low;
+};
+
+// A double split into the explicit bits of its mantissa and its biased
+// exponent.
+struct AdjustedMantissa {
+  uint64_t mantissa;
+  int32_t power2;
+};
+
+// Spans of the digits of a decimal number before and after the dot along
+// with its explicit exponent.
+struct DecimalNumber {
+  const char* integer_begin;
+  const char* integer_end;
+  const char* fraction_begin;
+  const char* fraction_end;
+  int64_t exponent;
+};
+
+// An arbitrary precision unsigned integer, only used to round the numbers
+// that are too close to the middle between two doubles.
+class BigInteger {
+ public:
+  explicit BigInteger(uint64_t value);
+
+  void MultiplyAdd(uint32_t factor, uint32_t addend);
+  void MultiplyByPowerOfFive(int64_t exponent);
+  void ShiftLeft(int64_t bits);
+
+  // Returns a negative number, zero or a positive number if this integer is
+  // less than, equal to or greater than `other`.
+  int Compare(const BigInteger& other) const;
+
+ private:
+  // 32-bit limbs from the least significant one, without leading zeros.
+  vector<uint32_t> limbs_;
+};
+
+}  // namespace
+
+// Count of bits of the mantissa of a double without the implicit one.
+static const int kMantissaBits = 52;
+
+static const int kMinimumExponent = -1023;
+static const int32_t kInfinitePower = 0x7FF;
+
+// Integers up to that are exactly representable by doubles.
+static const uint64_t kMaxExactInteger = uint64_t(1) << 53;
+
+// Integers of up to that many digits always fit into 64 bits.
+static const int64_t kMaxMantissaDigits = 19;
+static const uint64_t kMinNineteenDigitInteger = 1000000000000000000ull;
+
+// Integers of up to that many digits are exact doubles.
+static const ptrdiff_t kMaxExactIntegerDigits = 15;
+
+// Digits past that many significant ones can't affect the rounding other
+// than by being non-zero.
+static const int64_t kMaxSignificantDigits = 800;
+
+// Powers of ten that are exactly representable by doubles.
+static const double kPowersOfTen[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int64_t kMaxExactPowerOfTen = 22;
+
+static inline bool IsDigit(char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// Returns the value of the digit `c` in bases up to 16, or 16 if `c` is not
+// a digit.
+static inline unsigned GetDigitValue(char c) {
+  if (IsDigit(c)) {
+    return c - '0';
+  }
+  const char lower = c | 0x20;
+  if (lower >= 'a' && lower <= 'f') {
+    return lower - 'a' + 10;
+  }
+  return 16;
+}
+
+// Returns the count of leading zero bits of a non-zero `value`.
+static inline int CountLeadingZeros(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return 63 - static_cast<int>(index);
+#elif defined(_MSC_VER)
+  int count = 0;
+  for (; (value >> 63) == 0; value <<= 1) {
+    count++;
+  }
+  return count;
+#else
+  return __builtin_clzll(value);
+#endif
+}
+
+static inline UInt128 Multiply(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return {static_cast<uint64_t>(product >> 64),
+          static_cast<uint64_t>(product)};
+#elif defined(_MSC_VER) && defined(_M_X64)
+  uint64_t high;
+  const uint64_t low = _umul128(a, b, &high);
+  return {high, low};
+#else
+  const uint64_t a_low = a & 0xFFFFFFFF;
+  const uint64_t a_high = a >> 32;
+  const uint64_t b_low = b & 0xFFFFFFFF;
+  const uint64_t b_high = b >> 32;
+  const uint64_t low_low = a_low * b_low;
+  const uint64_t high_low = a_high * b_low + (low_low >> 32);
+  const uint64_t low_high = a_low * b_high + (high_low & 0xFFFFFFFF);
+  return {a_high * b_high + (high_low >> 32) + (low_high >> 32),
+          (low_high << 32) | (low_low & 0xFFFFFFFF)};
+#endif
+}
+
+static inline double FromBits(uint64_t bits) {
+  double result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+static inline uint64_t ToBits(const AdjustedMantissa& value) {
+  return value.mantissa |
+         static_cast<uint64_t>(value.power2) << kMantissaBits;
+}
+
+BigInteger::BigInteger(uint64_t value) {
+  for (; value != 0; value >>= 32) {
+    limbs_.push_back(static_cast<uint32_t>(value));
+  }
+}
+
+void BigInteger::MultiplyAdd(uint32_t factor, uint32_t addend) {
+  uint64_t carry = addend;
+  for (uint32_t& limb : limbs_) {
+    const uint64_t product = static_cast<uint64_t>(limb) * factor + carry;
+    limb = static_cast<uint32_t>(product);
+    carry = product >> 32;
+  }
+  if (carry != 0) {
+    limbs_.push_back(static_cast<uint32_t>(carry));
+  }
+}
+
+void BigInteger::MultiplyByPowerOfFive(int64_t exponent) {
+  // 5^13 is the largest power of five that fits into 32 bits.
+  for (; exponent >= 13; exponent -= 13) {
+    MultiplyAdd(1220703125, 0);
+  }
+  uint32_t factor = 1;
+  for (; exponent > 0; exponent--) {
+    factor *= 5;
+  }
+  MultiplyAdd(factor, 0);
+}
+
+void BigInteger::ShiftLeft(int64_t bits) {
+  if (limbs_.empty()) {
+    return;
+  }
+  limbs_.insert(limbs_.begin(), static_cast<size_t>(bits / 32), 0);
+  const int shift = static_cast<int>(bits % 32);
+  if (shift == 0) {
+    return;
+  }
+  uint32_t carry = 0;
+  for (uint32_t& limb : limbs_) {
+    const uint32_t next_carry = limb >> (32 - shift);
+    limb = (limb << shift) | carry;
+    carry = next_carry;
+  }
+  if (carry != 0) {
+    limbs_.push_back(carry);
+  }
+}
+
+int BigInteger::Compare(const BigInteger& other) const {
+  if (limbs_.size() != other.limbs_.size()) {
+    return limbs_.size() < other.limbs_.size() ? -1 : 1;
+  }
+  for (size_t i = limbs_.size(); i-- > 0;) {
+    if (limbs_[i] != other.limbs_[i]) {
+      return limbs_[i] < other.limbs_[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// Returns the product of the 64-bit `mantissa` normalized so that its most
+// significant bit is set and 5^`q`, precise enough to find out the bits of
+// the mantissa of a double and whether it has to be rounded up.
+static UInt128 ComputeProductApproximation(int64_t q, uint64_t mantissa) {
+  const size_t index = static_cast<size_t>(2 * (q - SMALLEST_POWER_OF_FIVE));
+  UInt128 first = Multiply(mantissa, POWERS_OF_FIVE_128[index]);
+  const uint64_t precision_mask =
+      numeric_limits<uint64_t>::max() >> (kMantissaBits + 3);
+  if ((first.high & precision_mask) == precision_mask) {
+    const UInt128 second = Multiply(mantissa, POWERS_OF_FIVE_128[index + 1]);
+    first.low += second.high;
+    if (second.high > first.low) {
+      first.high++;
+    }
+  }
+  return first;
+}
+
+// Returns floor(log2(5^q)) + q + 63.
+static inline int32_t ComputePower2(int64_t q) {
+  return static_cast<int32_t>(((152170 + 65536) * q) >> 16) + 63;
+}
+
+// Returns the double nearest to `mantissa` * 10^`q` using the algorithm of
+// Eisel and Lemire, see "Number Parsing at a Gigabyte per Second" by Daniel
+// Lemire.
+static AdjustedMantissa ComputeFloat(int64_t q, uint64_t mantissa) {
+  AdjustedMantissa result = {0, 0};
+  if (mantissa == 0 || q < SMALLEST_POWER_OF_FIVE) {
+    return result;
+  }
+  if (q > LARGEST_POWER_OF_FIVE) {
+    result.power2 = kInfinitePower;
+    return result;
+  }
+
+  const int leading_zeros = CountLeadingZeros(mantissa);
+  mantissa <<= leading_zeros;
+  const UInt128 product = ComputeProductApproximation(q, mantissa);
+
+  const int upper_bit = static_cast<int>(product.high >> 63);
+  const int shift = upper_bit + 64 - kMantissaBits - 3;
+  result.mantissa = product.high >> shift;
+  result.power2 = ComputePower2(q) + upper_bit - leading_zeros -
+                  kMinimumExponent;
+
+  if (result.power2 <= 0) {
+    // The result is subnormal, unless it gets normal after rounding.
+    if (-result.power2 + 1 >= 64) {
+      result.mantissa = 0;
+      result.power2 = 0;
+      return result;
+    }
+    result.mantissa >>= -result.power2 + 1;
+    result.mantissa += result.mantissa & 1;
+    result.mantissa >>= 1;
+    result.power2 =
+        result.mantissa < (uint64_t(1) << kMantissaBits) ? 0 : 1;
+    return result;
+  }
+
+  // Rounds to even exactly in the middle, which is only possible for small
+  // powers of ten.
+  if (product.low <= 1 && q >= -4 && q <= 23 &&
+      (result.mantissa & 3) == 1 &&
+      (result.mantissa << shift) == product.high) {
+    result.mantissa &= ~uint64_t(1);
+  }
+
+  result.mantissa += result.mantissa & 1;
+  result.mantissa >>= 1;
+  if (result.mantissa >= (uint64_t(2) << kMantissaBits)) {
+    result.mantissa = uint64_t(1) << kMantissaBits;
+    result.power2++;
+  }
+  result.mantissa &= ~(uint64_t(1) << kMantissaBits);
+
+  if (result.power2 >= kInfinitePower) {
+    result.mantissa = 0;
+    result.power2 = kInfinitePower;
+  }
+  return result;
+}
+
+// Collects up to kMaxSignificantDigits significant digits of the `number`
+// into `digits` and returns the decimal exponent of the last one. Digits
+// past that are replaced by a single one if any of them is not zero.
+static int64_t CollectDigits(const DecimalNumber& number,
+                             BigInteger*          digits) {
+  const int64_t fraction_size = number.fraction_end - number.fraction_begin;
+  int64_t exponent = number.exponent - fraction_size;
+  int64_t count = 0;
+  bool has_nonzero_tail = false;
+  uint32_t chunk = 0;
+  uint32_t chunk_scale = 1;
+
+  const char* spans[][2] = {
+    {number.integer_begin, number.integer_end},
+    {number.fraction_begin, number.fraction_end}
+  };
+  for (const auto& span : spans) {
+    for (const char* p = span[0]; p < span[1]; p++) {
+      const uint32_t digit = *p - '0';
+      if (count == 0 && digit == 0) {
+        continue;
+      }
+      if (count == kMaxSignificantDigits) {
+        has_nonzero_tail = has_nonzero_tail || digit != 0;
+        exponent++;
+        continue;
+      }
+      chunk = chunk * 10 + digit;
+      chunk_scale *= 10;
+      count++;
+      if (chunk_scale == 1000000000) {
+        digits->MultiplyAdd(chunk_scale, chunk);
+        chunk = 0;
+        chunk_scale = 1;
+      }
+    }
+  }
+  digits->MultiplyAdd(chunk_scale, chunk);
+
+  if (has_nonzero_tail) {
+    digits->MultiplyAdd(10, 1);
+    exponent--;
+  }
+  return exponent;
+}
+
+// Returns the double nearest to the `number` given the double `lower`, which
+// is either the result or the double preceding it. The number is compared
+// exactly with the middle between the two doubles.
+static double RoundExactly(const DecimalNumber&    number,
+                           const AdjustedMantissa& lower) {
+  uint64_t mantissa = lower.mantissa;
+  int64_t exponent2 = 1 + kMinimumExponent - kMantissaBits;
+  if (lower.power2 != 0) {
+    mantissa |= uint64_t(1) << kMantissaBits;
+    exponent2 += lower.power2 - 1;
+  }
+
+  // Compares digits * 10^exponent10 with middle * 2^(exponent2 - 1).
+  BigInteger digits(0);
+  const int64_t exponent10 = CollectDigits(number, &digits);
+  BigInteger middle(2 * mantissa + 1);
+
+  if (exponent10 >= 0) {
+    digits.MultiplyByPowerOfFive(exponent10);
+  } else {
+    middle.MultiplyByPowerOfFive(-exponent10);
+  }
+  const int64_t shift = exponent10 - (exponent2 - 1);
+  if (shift >= 0) {
+    digits.ShiftLeft(shift);
+  } else {
+    middle.ShiftLeft(-shift);
+  }
+
+  uint64_t bits = ToBits(lower);
+  const int comparison = digits.Compare(middle);
+  if (comparison > 0 || (comparison == 0 && (mantissa & 1) != 0)) {
+    bits++;
+  }
+  return FromBits(bits);
+}
+
+// Parses `NaN` and `Infinity`. Other spellings that strtod() would accept
+// are reported as errors, anything else is not a number.
+static Status ParseSpecialNumber(const char* begin,
+                                 const char* end,
+                                 size_t*     size,
+                                 double*     result) {
+  const size_t length = end - begin;
+  if (length < 3) {
+    return Status::kOk;
+  }
+  const char lower[] = {static_cast<char>(begin[0] | 0x20),
+                        static_cast<char>(begin[1] | 0x20),
+                        static_cast<char>(begin[2] | 0x20)};
+  if (memcmp(lower, "nan", 3) == 0) {
+    if (begin[1] != 'a' || begin[2] != 'N') {
+      return Status::kExpectedNaN;
+    }
+    *size = 3;
+    *result = numeric_limits<double>::quiet_NaN();
+  } else if (memcmp(lower, "inf", 3) == 0) {
+    if (length < 8 || memcmp(begin + 1, "nfinity", 7) != 0) {
+      return Status::kExpectedInfinity;
+    }
+    *size = 8;
+    *result = numeric_limits<double>::infinity();
+  }
+  return Status::kOk;
+}
+
+Status ParseDecimalNumber(const char* begin,
+                          const char* end,
+                          size_t*     size,
+                          double*     result) {
+  *size = 0;
+  *result = 0;
+  if (begin == end) {
+    return Status::kOk;
+  }
+  if (!IsDigit(*begin) && *begin != '.') {
+    return ParseSpecialNumber(begin, end, size, result);
+  }
+
+  const char* p = begin;
+  uint64_t mantissa = 0;
+  for (; p < end && IsDigit(*p); p++) {
+    mantissa = mantissa * 10 + (*p - '0');
+  }
+
+  // Short integers, which make up most of the numbers, are exact doubles.
+  if ((p == end || (*p != '.' && *p != 'e' && *p != 'E')) &&
+      p - begin <= kMaxExactIntegerDigits) {
+    *size = p - begin;
+    *result = static_cast<double>(mantissa);
+    return Status::kOk;
+  }
+
+  DecimalNumber number = {begin, p, p, p, 0};
+  int64_t digit_count = p - begin;
+  if (p < end && *p == '.') {
+    number.fraction_begin = ++p;
+    for (; p < end && IsDigit(*p); p++) {
+      mantissa = mantissa * 10 + (*p - '0');
+    }
+    number.fraction_end = p;
+    digit_count += p - number.fraction_begin;
+  }
+  if (digit_count == 0) {
+    return Status::kOk;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* exponent_begin = p + 1;
+    bool is_negative = false;
+    if (exponent_begin < end &&
+        (*exponent_begin == '+' || *exponent_begin == '-')) {
+      is_negative = *exponent_begin == '-';
+      exponent_begin++;
+    }
+    if (exponent_begin < end && IsDigit(*exponent_begin)) {
+      int64_t exponent = 0;
+      for (p = exponent_begin; p < end && IsDigit(*p); p++) {
+        if (exponent < 0x10000000) {
+          exponent = exponent * 10 + (*p - '0');
+        }
+      }
+      number.exponent = is_negative ? -exponent : exponent;
+    }
+  }
+  *size = p - begin;
+
+  const int64_t fraction_size = number.fraction_end - number.fraction_begin;
+  int64_t exponent = number.exponent - fraction_size;
+
+  // Only the first 19 significant digits are used if there are more, then
+  // the number lies between `mantissa` and `mantissa + 1` times 10^exponent.
+  bool has_too_many_digits = false;
+  if (digit_count > kMaxMantissaDigits) {
+    for (const char* q = begin; q < number.fraction_end &&
+                                (*q == '0' || *q == '.'); q++) {
+      if (*q == '0') {
+        digit_count--;
+      }
+    }
+    if (digit_count > kMaxMantissaDigits) {
+      has_too_many_digits = true;
+      mantissa = 0;
+      const char* q = number.integer_begin;
+      for (; mantissa < kMinNineteenDigitInteger && q < number.integer_end;
+           q++) {
+        mantissa = mantissa * 10 + (*q - '0');
+      }
+      if (mantissa >= kMinNineteenDigitInteger) {
+        exponent = number.integer_end - q + number.exponent;
+      } else {
+        q = number.fraction_begin;
+        for (; mantissa < kMinNineteenDigitInteger &&
+               q < number.fraction_end; q++) {
+          mantissa = mantissa * 10 + (*q - '0');
+        }
+        exponent = number.fraction_begin - q + number.exponent;
+      }
+    }
+  }
+
+  double value;
+  if (!has_too_many_digits && mantissa <= kMaxExactInteger &&
+      exponent >= -kMaxExactPowerOfTen && exponent <= kMaxExactPowerOfTen) {
+    // Both operands are exact, so the result is correctly rounded.
+    value = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      value /= kPowersOfTen[-exponent];
+    } else {
+      value *= kPowersOfTen[exponent];
+    }
+  } else {
+    const AdjustedMantissa lower = ComputeFloat(exponent, mantissa);
+    if (has_too_many_digits &&
+        ToBits(lower) != ToBits(ComputeFloat(exponent, mantissa + 1))) {
+      value = RoundExactly(number, lower);
+    } else {
+      value = FromBits(ToBits(lower));
+    }
+  }
+
+  if (std::isinf(value)) {
+    return Status::kExpectedInfinity;
+  }
+  *result = value;
+  return Status::kOk;
+}
+
+double ParseIntegerNumber(const char* begin,
+                          const char* end,
+                          int         base,
+                          size_t*     size) {
+  const int digit_bits = base == 16 ? 4 : base == 8 ? 3 : 1;
+
+  // The 64 most significant bits are kept in `value`, the rest are only
+  // counted and checked for being non-zero.
+  uint64_t value = 0;
+  int64_t dropped_bits = 0;
+  bool has_nonzero_tail = false;
+
+  const char* p = begin;
+  for (; p < end; p++) {
+    const unsigned digit = GetDigitValue(*p);
+    if (digit >= static_cast<unsigned>(base)) {
+      break;
+    }
+    if ((value >> (64 - digit_bits)) == 0) {
+      value = (value << digit_bits) | digit;
+      continue;
+    }
+    for (int bit = digit_bits - 1; bit >= 0; bit--) {
+      const uint64_t bit_value = (digit >> bit) & 1;
+      if ((value >> 63) == 0) {
+        value = (value << 1) | bit_value;
+      } else {
+        dropped_bits++;
+        has_nonzero_tail = has_nonzero_tail || bit_value != 0;
+      }
+    }
+  }
+  *size = p - begin;
+
+  if (value < kMaxExactInteger) {
+    return static_cast<double>(value);
+  }
+
+  // Rounds to the nearest double, ties to even.
+  const int shift = 64 - CountLeadingZeros(value) - (kMantissaBits + 1);
+  uint64_t mantissa = value >> shift;
+  const uint64_t rest = value & ((uint64_t(1) << shift) - 1);
+  const uint64_t half = uint64_t(1) << (shift - 1);
+  if (rest > half ||
+      (rest == half && (has_nonzero_tail || (mantissa & 1) != 0))) {
+    mantissa++;
+  }
+  const int64_t exponent = shift + dropped_bits;
+  return ldexp(static_cast<double>(mantissa),
+               exponent > 2048 ? 2048 : static_cast<int>(exponent));
+}
+
+}  // namespace number_parser
+
+}  // namespace mdsf
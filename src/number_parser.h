@@ -0,0 +1,42 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_NUMBER_PARSER_H_
+#define SRC_NUMBER_PARSER_H_
+
+#include <cstddef>
+
+namespace mdsf {
+
+namespace number_parser {
+
+enum class Status {
+  kOk,
+  kExpectedNaN,
+  kExpectedInfinity
+};
+
+// Parses a decimal number without a sign, `NaN` or `Infinity` in the range
+// from `begin` to `end`, writes the correctly rounded value to `result` and
+// its size to `size`. Both are zero if there is no number at `begin`.
+// Numbers that overflow are reported as an invalid `Infinity`. Never reads
+// outside of the range and does not depend on the locale.
+Status ParseDecimalNumber(const char*  begin,
+                          const char*  end,
+                          std::size_t* size,
+                          double*      result);
+
+// Parses an integer number in base 2, 8 or 16 without a prefix or a sign in
+// the range from `begin` to `end` and returns the correctly rounded value.
+// Writes the size of the number to `size`, which is zero if there are no
+// digits at `begin`.
+double ParseIntegerNumber(const char*  begin,
+                          const char*  end,
+                          int          base,
+                          std::size_t* size);
+
+}  // namespace number_parser
+
+}  // namespace mdsf
+
+#endif  // SRC_NUMBER_PARSER_H_
@@ -5,946 +5,476 @@
 
 #include "parser.h"
 
-#include <cctype>
-#include <cerrno>
-#include <cmath>
 #include <cstddef>
 #include <cstdint>
-#include <cstdlib>
 #include <cstring>
-#include <functional>
 #include <vector>
 
+#include <node.h>
+
 #include "common.h"
-#include "unicode_utils.h"
-
-using std::atof;
-using std::function;
-using std::isalnum;
-using std::isalpha;
-using std::isdigit;
-using std::isxdigit;
-using std::memcpy;
-using std::memset;
-using std::ptrdiff_t;
+#include "external_string.h"
+#include "isolate_data.h"
+#include "key_cache.h"
+#include "shape_cache.h"
+#include "tape.h"
+
+using std::memcmp;
 using std::size_t;
-using std::strncmp;
-using std::strncpy;
-using std::strtol;
-using std::toupper;
+using std::uint32_t;
+using std::vector;
 
 using v8::Array;
+using v8::Context;
+using v8::Exception;
 using v8::False;
-using v8::Integer;
+using v8::Function;
 using v8::Isolate;
 using v8::Local;
 using v8::Maybe;
+using v8::Nothing;
 using v8::MaybeLocal;
+using v8::Name;
 using v8::NewStringType;
 using v8::Null;
 using v8::Number;
 using v8::Object;
+using v8::ObjectTemplate;
 using v8::String;
 using v8::True;
 using v8::Undefined;
 using v8::Value;
 
-using mdsf::unicode_utils::CodePointToUtf8;
-using mdsf::unicode_utils::IsWhiteSpaceCharacter;
-using mdsf::unicode_utils::IsLineTerminatorSequence;
-using mdsf::unicode_utils::Utf8ToCodePoint;
-using mdsf::unicode_utils::IsIdStartCodePoint;
-using mdsf::unicode_utils::IsIdPartCodePoint;
+using mdsf::external_string::NewExternalOneByte;
+using mdsf::key_cache::KeyCache;
+using mdsf::shape_cache::ShapeCache;
+using mdsf::tape::Node;
+using mdsf::tape::NodeType;
+using mdsf::tape::Schema;
+using mdsf::tape::Tape;
 
 namespace mdsf {
 
 namespace parser {
 
-// Enumeration of supported JavaScript types used for deserialization
-// function selection.
-enum Type {
-  kUndefined = 0, kNull, kBool, kNumber, kString, kArray, kObject, kDate
-};
-
-// Parses the type of the serialized JavaScript value at the position `begin`
-// and before `end`. Returns true if it was able to detect the type, false
-// otherwise.
-static bool GetType(const char* begin, const char* end, Type* type);
-
-// The table of parsing functions indexed with the values of the Type
-// enumeration.
-static constexpr MaybeLocal<Value> (*kParseFunctions[])(Isolate*,
-                                                        const char*,
-                                                        const char*,
-                                                        size_t*) = {
-  &internal::ParseUndefined,
-  &internal::ParseNull,
-  &internal::ParseBool,
-  &internal::ParseNumber,
-  &internal::ParseString,
-  &internal::ParseArray,
-  &internal::ParseObject
-};
-
-Local<Value> Parse(Isolate* isolate, const char* str, size_t length) {
-  const char* end = str + length;
-
-  Type type;
-
-  size_t start_pos = internal::SkipToNextToken(str, end);
-  if (!GetType(str + start_pos, end, &type)) {
-    THROW_EXCEPTION(TypeError, "Invalid type");
+Local<Value> Parse(Isolate*       isolate,
+                   const char*    str,
+                   size_t         length,
+                   const Options& options) {
+  isolate_data::ScopedTape tape(isolate_data::Get(isolate));
+  tape::Error error;
+
+  if (!tape::Parse(str, str + length, tape.get(), &error,
+                   options.max_depth, options.schema,
+                   options.validate_utf8)) {
+    isolate->ThrowException(internal::CreateError(isolate, error));
     return Undefined(isolate);
   }
 
-  size_t parsed_size = 0;
-  MaybeLocal<Value> result = kParseFunctions[type](isolate,
-                                                   str + start_pos,
-                                                   end,
-                                                   &parsed_size);
+  size_t position = 0;
+  MaybeLocal<Value> result =
+      internal::CreateValue(isolate, *tape.get(), &position, options);
 
   if (result.IsEmpty()) {
     return Undefined(isolate);
   }
 
-  parsed_size += internal::SkipToNextToken(str + start_pos + parsed_size, end);
-  parsed_size += start_pos;
-
-  if (length != parsed_size) {
-    THROW_EXCEPTION(SyntaxError, "Invalid format");
-    return Undefined(isolate);
-  }
-
   return result.ToLocalChecked();
 }
 
-static bool GetType(const char* begin, const char* end, Type* type) {
-  bool result = true;
-  switch (*begin) {
-    case ',':
-    case ']': {
-      *type = Type::kUndefined;
-      break;
-    }
-    case '{': {
-      *type = Type::kObject;
-      break;
-    }
-    case '[': {
-      *type = Type::kArray;
-      break;
-    }
-    case '\"':
-    case '\'': {
-      *type = Type::kString;
-      break;
-    }
-    case 't':
-    case 'f': {
-      *type = Type::kBool;
-      break;
-    }
-    case 'n': {
-      *type = Type::kNull;
-      if (begin + 4 <= end) {
-        result = (strncmp(begin, "null", 4) == 0);
-      }
-      break;
-    }
-    case 'u': {
-      *type = Type::kUndefined;
-      if (begin + 9 <= end) {
-        result = (strncmp(begin, "undefined", 9) == 0);
-      }
-      break;
-    }
-    case 'N':
-    case 'I': {
-      *type = Type::kNumber;
-      break;
-    }
-    default: {
-      result = false;
-      if (isdigit(*begin) || *begin == '.' || *begin == '+' || *begin == '-') {
-        *type = Type::kNumber;
-        result = true;
-      }
-    }
-  }
-  return result;
-}
-
 namespace internal {
 
-// Returns true if `str` points to a multiline comment ending, false otherwise.
-bool IsMultilineCommentEnd(const char* str, size_t* size) {
-  if (str[0] == '*' && str[1] == '/') {
-    *size = 2;
-    return true;
-  }
-  return false;
-}
+// Array indices are integers from 0 to 2^32 - 2.
+static const double kMaxArrayIndex = 4294967295.0;
 
-// Returns count of bytes needed to skip to current comment ending.
-size_t SkipToCommentEnd(const char* str, const char* end) {
-  bool is_single_line;
+// State shared by all of the values created from a single tape.
+struct CreationState {
+  // Caches of the object keys and layouts of the current isolate.
+  KeyCache* key_cache;
+  ShapeCache* shape_cache;
 
-  switch (str[1]) {
-    case '/': {
-      is_single_line = true;
-      break;
-    }
-    case '*': {
-      is_single_line = false;
-      break;
-    }
-    default: {  // In case it is not a comment start
-      return 0;
-    }
-  }
+  // Scratch storage for the elements of the arrays being created, shared by
+  // the nested ones.
+  vector<Local<Value>> stack;
 
-  function<bool(const char*, size_t*)> end_check_func;
-
-  if (is_single_line) {
-    end_check_func = IsLineTerminatorSequence;
-  } else {
-    end_check_func = IsMultilineCommentEnd;
-  }
-
-  const size_t size = end - str;
-
-  size_t pos = 2;
-  size_t current_size;
-
-  for (; pos < size; pos++) {
-    if (end_check_func(str + pos, &current_size)) {
-      return pos + current_size;
-    }
-  }
+  const Options* options;
+};
 
-  if (is_single_line) {
-    return pos;
-  } else {
-    return 0;
-  }
+// Creates a property key from the node `*position` of the `tape` and
+// advances `position` past it. String keys are taken from the key cache.
+static MaybeLocal<String> CreateKey(Isolate*       isolate,
+                                    const Tape&    tape,
+                                    size_t*        position,
+                                    CreationState* state) {
+  const Node& node = tape.nodes[(*position)++];
+  if (node.type == NodeType::kNumber) {
+    return Number::New(isolate, node.number)->ToString(
+        isolate->GetCurrentContext());
+  }
+  return state->key_cache->Get(isolate, node.string, node.size,
+                               node.is_ascii);
 }
 
-size_t SkipToNextToken(const char* str, const char* end) {
-  size_t pos = 0;
-  size_t current_size;
-  const size_t size = end - str;
-
-  while (pos < size) {
-    if (IsWhiteSpaceCharacter(str + pos, &current_size) ||
-        IsLineTerminatorSequence(str + pos, &current_size)) {
-      pos += current_size;
-    } else if (str[pos] == '/') {
-      size_t to_skip = SkipToCommentEnd(str + pos, end);
-      if (!to_skip) {
-        break;
-      }
-      pos += to_skip;
-    } else {
-      break;
-    }
+// Returns true if the key `node` is a number which is a valid array index
+// and writes it to `index`.
+static bool GetArrayIndex(const Node& node, uint32_t* index) {
+  if (node.type != NodeType::kNumber ||
+      !(node.number >= 0 && node.number < kMaxArrayIndex)) {
+    return false;
   }
-
-  return pos;
+  *index = static_cast<uint32_t>(node.number);
+  return *index == node.number;
 }
 
-MaybeLocal<Value> ParseUndefined(Isolate*    isolate,
-                                 const char* begin,
-                                 const char* end,
-                                 size_t*     size) {
-  if (*begin == ',' || *begin == ']') {
-    *size = 0;
-  } else if (*begin == 'u') {
-    *size = 9;
-  } else {
-    THROW_EXCEPTION(TypeError, "Invalid format of undefined value");
-    return MaybeLocal<Value>();
-  }
-  return Undefined(isolate);
+// Returns true if the key `node` is `__proto__`, which is assigned rather
+// than defined, so that it sets the prototype the same way the JavaScript
+// parser does.
+static bool IsProtoKey(const Node& node) {
+  return node.type == NodeType::kString && node.size == 9 &&
+         memcmp(node.string, "__proto__", 9) == 0;
 }
 
-MaybeLocal<Value> ParseNull(Isolate*    isolate,
-                            const char* begin,
-                            const char* end,
-                            size_t*     size) {
-  *size = 4;
-  return Null(isolate);
+// Returns true if the key `node` is a string which may be a part of a cached
+// layout, that is, neither `__proto__` nor a string that may be an array
+// index.
+static bool IsPlainKey(const Node& node) {
+  return node.type == NodeType::kString && !IsProtoKey(node) &&
+         !(node.size > 0 && node.string[0] >= '0' && node.string[0] <= '9');
 }
 
-MaybeLocal<Value> ParseBool(Isolate*    isolate,
-                            const char* begin,
-                            const char* end,
-                            size_t*     size) {
-  MaybeLocal<Value> result;
-  if (begin + 4 <= end && strncmp(begin, "true", 4) == 0) {
-    result = True(isolate);
-    *size = 4;
-  } else if (begin + 5 <= end && strncmp(begin, "false", 5) == 0) {
-    result = False(isolate);
-    *size = 5;
-  } else {
-    THROW_EXCEPTION(TypeError, "Invalid format: expected boolean");
-  }
-  return result;
+// Creates an object for the `length` key/value pairs at `properties`, from
+// the template of their layout if it is cached. Templates are only used
+// since Node.js 12, older versions of V8 instantiate them slower than they
+// add the properties one by one.
+static MaybeLocal<Object> NewObject(Isolate*            isolate,
+                                    const Local<Value>* properties,
+                                    size_t              length,
+                                    CreationState*      state) {
+#if NODE_MODULE_VERSION >= 72
+  Local<ObjectTemplate> object_template;
+  if (state->shape_cache->Get(isolate, properties, length)
+          .ToLocal(&object_template)) {
+    return object_template->NewInstance(isolate->GetCurrentContext());
+  }
+#endif
+  return Object::New(isolate);
 }
 
-MaybeLocal<Value> ParseNumber(Isolate*    isolate,
-                              const char* begin,
-                              const char* end,
-                              size_t*     size) {
-  bool negate_result = false;
-  const char* number_start = begin;
-
-  if (*begin == '+' || *begin == '-') {
-    negate_result = *begin == '-';
-    number_start++;
-  }
-
-  int base = 10;
-
-  if (*number_start == '0') {
-    number_start++;
-
-    if (*number_start == 'b' || *number_start == 'B') {
-      base = 2;
-      number_start++;
-    } else if (*number_start == 'o' || *number_start == 'O') {
-      base = 8;
-      number_start++;
-    } else if (*number_start == 'x' || *number_start == 'X') {
-      base = 16;
-      number_start++;
-    } else if (isdigit(*number_start)) {
-      THROW_EXCEPTION(SyntaxError,
-          "Legacy octal and non-octal integer literals are not supported");
-      return MaybeLocal<Value>();
-    } else {
-      number_start--;
+// Defines the `length` key/value pairs at `properties` on the `object`.
+static bool DefineProperties(Local<Context>      context,
+                             Local<Object>       object,
+                             const Local<Value>* properties,
+                             size_t              length) {
+  for (size_t i = 0; i < length; i++) {
+    Maybe<bool> is_ok = object->CreateDataProperty(
+        context, properties[i * 2].As<Name>(), properties[i * 2 + 1]);
+    if (is_ok.IsNothing()) {
+      return false;
     }
   }
-
-  MaybeLocal<Value> result;
-
-  if (base == 10) {
-    result = ParseDecimalNumber(isolate, number_start, end, size,
-                                negate_result);
-  } else {
-    result = ParseIntegerNumber(isolate, number_start, end, size,
-                                base, negate_result);
-    if (*size == 0) {
-      THROW_EXCEPTION(SyntaxError, "Empty number value");
-      return MaybeLocal<Value>();
-    }
-  }
-  *size += number_start - begin;
-  return result;
+  return true;
 }
 
-MaybeLocal<Value> ParseDecimalNumber(Isolate*    isolate,
-                                     const char* begin,
-                                     const char* end,
-                                     size_t*     size,
-                                     bool        negate_result) {
-  char* number_end;
-  double number = strtod(begin, &number_end);
-
-  if (negate_result) {
-    number = -number;
-  }
+// Creates a string from the string `node`. ASCII strings are created as
+// one-byte strings without UTF-8 decoding, and the long ones may be created
+// as external strings if the options of the `state` request that.
+static Local<String> CreateString(Isolate*       isolate,
+                                  const Node&    node,
+                                  CreationState* state) {
+  if (!node.is_ascii) {
+    return NewFromUtf8OrEmpty(isolate, node.string, NewStringType::kNormal,
+                              static_cast<int>(node.size));
+  }
+  if (state->options->external_strings &&
+      node.size >= kMinExternalStringLength) {
+    return NewExternalOneByte(isolate, node.string, node.size);
+  }
+  return NewFromOneByteOrEmpty(isolate, node.string, NewStringType::kNormal,
+                               static_cast<int>(node.size));
+}
 
-  // strictly allow only "NaN" and "Infinity"
-  if (std::isnan(number)) {
-    if (strncmp(begin + 1, "aN", 2) != 0) {
-      THROW_EXCEPTION(SyntaxError, "Invalid format: expected NaN");
-      return MaybeLocal<Value>();
+// Creates the value of the scalar `node`.
+static Local<Value> CreateScalar(Isolate*       isolate,
+                                 const Node&    node,
+                                 CreationState* state) {
+  switch (node.type) {
+    case NodeType::kNull: {
+      return Null(isolate);
     }
-  } else if (std::isinf(number)) {
-    if (strncmp(begin + 1, "nfinity", 7) != 0) {
-      THROW_EXCEPTION(SyntaxError, "Invalid format: expected Infinity");
-      return MaybeLocal<Value>();
+    case NodeType::kTrue: {
+      return True(isolate);
     }
-  }
-
-  *size = number_end - begin;
-  return Number::New(isolate, number);
-}
-
-Local<Value> ParseIntegerNumber(Isolate*    isolate,
-                                const char* begin,
-                                const char* end,
-                                size_t*     size,
-                                int         base,
-                                bool        negate_result) {
-  char* number_end;
-  long long value = strtoll(begin, &number_end, base);
-  if (errno == ERANGE) {
-    errno = 0;
-    return ParseBigIntegerNumber(isolate, begin, end, size,
-                                 base, negate_result);
-  }
-  if (negate_result) {
-    value = -value;
-  }
-  *size = static_cast<size_t>(number_end - begin);
-  if (value > INT32_MIN && value < INT32_MAX) {
-    return Integer::New(isolate, value);
-  } else {
-    return Number::New(isolate, value);
-  }
-}
-
-Local<Value> ParseBigIntegerNumber(Isolate*    isolate,
-                                   const char* begin,
-                                   const char* end,
-                                   size_t*     size,
-                                   int         base,
-                                   bool        negate_result) {
-  *size = end - begin;
-  double result = 0.0;
-  char current_digit;
-  double current_digit_value;
-  char base_digit_count = base > 10 ? 10 : base;
-  char base_alpha_count = base > 10 ? base - 10 : 0;
-  for (size_t i = 0; i < *size; i++) {
-    current_digit = toupper(begin[i]);
-    if ((current_digit < '0' || current_digit >= '0' + base_digit_count) &&
-        (current_digit < 'A' || current_digit >= 'A' + base_alpha_count)) {
-      *size = i;
-      break;
+    case NodeType::kFalse: {
+      return False(isolate);
     }
-    current_digit_value = current_digit <= '9' ? current_digit - '0' :
-                                                 current_digit - 'A' + 10;
-    result *= base;
-    result += current_digit_value;
-  }
-  return Number::New(isolate, negate_result ? -result : result);
-}
-
-static bool GetControlChar(Isolate*    isolate,
-                           const char* str,
-                           size_t*     res_len,
-                           size_t*     size,
-                           char*       write_to);
-
-MaybeLocal<Value> ParseString(Isolate*    isolate,
-                              const char* begin,
-                              const char* end,
-                              size_t*     size) {
-  *size = end - begin;
-  char* result = nullptr;
-
-  enum { kApostrophe = 0, kQMarks} string_mode = (*begin == '\'') ?
-                                                 kApostrophe :
-                                                 kQMarks;
-  bool is_ended = false;
-  size_t res_index = 0;
-  size_t out_offset, in_offset;
-
-  for (size_t i = 1; i < *size; i++) {
-    if ((string_mode == kQMarks     && begin[i] == '\"') ||
-        (string_mode == kApostrophe && begin[i] == '\'')) {
-      is_ended = true;
-      *size = i + 1;
-      break;
+    case NodeType::kNumber: {
+      return Number::New(isolate, node.number);
     }
-
-    if (begin[i] == '\\') {
-      if (!result) {
-        result = new char[*size + 1];
-        memcpy(result, begin + 1, i - 1);
-      }
-      if (IsLineTerminatorSequence(begin + i + 1, &in_offset)) {
-        i += in_offset;
-      } else {
-        bool ok = GetControlChar(isolate, begin + ++i, &out_offset, &in_offset,
-                                 result + res_index);
-        if (!ok) {
-          delete[] result;
-          return MaybeLocal<Value>();
-        }
-        i += in_offset - 1;
-        res_index += out_offset;
-      }
-    } else if (IsLineTerminatorSequence(begin + i, &in_offset)) {
-      delete[] result;
-      THROW_EXCEPTION(SyntaxError, "Unexpected line end in string");
-      return MaybeLocal<Value>();
-    } else {
-      if (result) {
-        result[res_index] = begin[i];
-      }
-      res_index++;
+    case NodeType::kString: {
+      return CreateString(isolate, node, state);
+    }
+    default: {
+      return Undefined(isolate);
     }
   }
+}
 
-  if (!is_ended) {
-    delete[] result;
-    THROW_EXCEPTION(SyntaxError, "Error while parsing string");
-    return MaybeLocal<Value>();
-  }
+namespace {
+
+// An array or an object whose contents are being created.
+struct Container {
+  // The node of the container in the tape.
+  const Node* node;
+  // Count of elements or properties of the container and count of those
+  // created so far.
+  uint32_t length;
+  uint32_t count;
+  // Size of the stack of the CreationState when the container was opened.
+  // The elements of arrays, the values of objects matching a schema and the
+  // key/value pairs of other objects are collected above it, so that the
+  // container is created with all of them at once.
+  size_t base;
+  // An object the properties of which are defined one by one, since it has
+  // a key which is not plain, or empty as long as they are collected on the
+  // stack. The key of the property being created is held in `key` or in
+  // `index` if it is an array index, which goes to the elements without
+  // being converted to a string.
+  Local<Object> object;
+  Local<String> key;
+  uint32_t index;
+  bool is_index;
+  bool is_proto;
+};
 
-  Local<String> result_str;
-  if (result) {
-    result_str = NewFromUtf8OrEmpty(isolate, result, v8::NewStringType::kNormal,
-        static_cast<int>(res_index));
-    delete[] result;
-  } else {
-    result_str = NewFromUtf8OrEmpty(isolate, begin + 1,
-        v8::NewStringType::kNormal, static_cast<int>(*size - 2));
-  }
-  return result_str;
-}
+}  // namespace
+
+// Creates the container of the value collected on the stack of the `state`
+// or returns the object the properties have been defined on and frees its
+// part of the stack. Arrays are created with the exact size and packed
+// elements instead of growing one element at a time. Objects of a cached
+// layout are created from its template, and objects matching a schema by
+// the function of its layout, which gets the values of the properties in the
+// order of the keys of the schema.
+static MaybeLocal<Value> CloseContainer(Isolate*         isolate,
+                                        const Container& container,
+                                        CreationState*   state) {
+  vector<Local<Value>>* stack = &state->stack;
+  Local<Value>* contents = stack->data() + container.base;
+  const uint32_t length = container.length;
+  MaybeLocal<Value> result;
 
-static uint32_t ReadHexNumber(const char* str,
-                              size_t required_len,
-                              bool is_limited,
-                              size_t* len,
-                              bool* ok);
-
-// Parses a Unicode escape sequence after the '\u' part and returns it's
-// code point value. Supports surrogate pairs. Total size of escape
-// sequence (excluding first '\u') is written in `size`.
-static uint32_t ReadUnicodeEscapeSequence(Isolate* isolate,
-                                          const char* str,
-                                          size_t* size,
-                                          bool* ok) {
-  uint32_t result = 0xFFFD;
-
-  if (isxdigit(str[0])) {
-    result = ReadHexNumber(str, 4, true, nullptr, ok);
-    if (!*ok) {
-      THROW_EXCEPTION(SyntaxError, "Invalid Unicode escape sequence");
-      return 0xFFFD;
-    }
-    *size = 4;
-  } else if (str[0] == '{') {
-    size_t hex_size;
-    result = ReadHexNumber(str + 1, 0, false, &hex_size, ok);
-    if (!*ok || result > 0x10FFFF) {
-      THROW_EXCEPTION(SyntaxError, "Invalid Unicode escape sequence");
-      return 0xFFFD;
+  if (container.node->type == NodeType::kArray) {
+#if NODE_MODULE_VERSION >= 72
+    result = Array::New(isolate, contents, length);
+#else
+    auto context = isolate->GetCurrentContext();
+    Local<Array> array = Array::New(isolate, static_cast<int>(length));
+    for (uint32_t i = 0; i < length; i++) {
+      if (array->Set(context, i, contents[i]).IsNothing()) {
+        THROW_EXCEPTION(Error, "Cannot add element to array");
+        return MaybeLocal<Value>();
+      }
     }
-    *size = hex_size + 2;
+    result = array;
+#endif
+  } else if (container.node->schema != nullptr) {
+    const ObjectLayout& layout =
+        state->options->layouts[container.node->schema->id];
+    result = Local<Function>::New(isolate, layout.create)
+                 ->Call(isolate->GetCurrentContext(), Undefined(isolate),
+                        static_cast<int>(length), contents);
+  } else if (!container.object.IsEmpty()) {
+    result = container.object;
   } else {
-    THROW_EXCEPTION(SyntaxError, "Expected Unicode escape sequence");
-    *ok = false;
-  }
-
-  // check for surrogate pair
-  if (0xD800 <= result && result <= 0xDBFF) {
-    size_t low_size;
-    if (str[*size] == '\\' && str[*size + 1] == 'u') {
-      uint32_t low_sur = ReadUnicodeEscapeSequence(isolate,
-                                                   str + *size + 2,
-                                                   &low_size, ok);
-      if (!*ok || !(0xDC00 <= low_sur && low_sur <= 0xDFFF)) {
-        return result;
-      }
-      result = ((result - 0xD800) << 10) + low_sur - 0xDC00 + 0x10000;
-      *size += low_size + 2;
+    Local<Object> object;
+    if (!NewObject(isolate, contents, length, state).ToLocal(&object)) {
+      return MaybeLocal<Value>();
+    }
+    if (!DefineProperties(isolate->GetCurrentContext(), object, contents,
+                          length)) {
+      THROW_EXCEPTION(Error, "Cannot add property to object");
+      return MaybeLocal<Value>();
     }
+    result = object;
   }
 
+  stack->resize(container.base);
   return result;
 }
 
-// Parses a part of a JavaScript string representation after the backslash
-// character (i.e., an escape sequence without \) into an unescaped control
-// character and writes it to `write_to`.
-// Returns true if no error occured, false otherwise.
-static bool GetControlChar(Isolate*    isolate,
-                           const char* str,
-                           size_t*     res_len,
-                           size_t*     size,
-                           char*       write_to) {
-  *size = 1;
-  *res_len = 1;
-  bool ok;
-  switch (str[0]) {
-    case 'b': {
-      *write_to = '\b';
-      break;
-    }
-    case 'f': {
-      *write_to = '\f';
-      break;
-    }
-    case 'n': {
-      *write_to = '\n';
-      break;
-    }
-    case 'r': {
-      *write_to = '\r';
-      break;
-    }
-    case 't': {
-      *write_to = '\t';
-      break;
-    }
-    case 'v': {
-      *write_to = '\v';
-      break;
-    }
-
-    case 'x': {
-      *write_to = static_cast<char>(ReadHexNumber(str + 1, 2, true,
-          nullptr, &ok));
-      if (!ok) {
-        THROW_EXCEPTION(SyntaxError, "Invalid hexadecimal escape sequence");
-        return false;
-      }
-      *size = 3;
-      break;
-    }
-
-    case 'u': {
-      uint32_t symb_code = ReadUnicodeEscapeSequence(isolate,
-                                                     str + 1,
-                                                     size,
-                                                     &ok);
-
-      if (!ok) {
-        return false;
-      }
-      CodePointToUtf8(symb_code, res_len, write_to);
-      *size += 1;
-      break;
-    }
+// Creates the key of the next property of the object `container` from the
+// node `*position` of the `tape` and advances `position` past it. The keys
+// of objects matching a schema are known in advance and skipped. As soon as
+// a key is not plain, the object is created with the properties collected so
+// far and the rest of them are defined on it one by one.
+static bool CreateContainerKey(Isolate*       isolate,
+                               const Tape&    tape,
+                               size_t*        position,
+                               Container*     container,
+                               CreationState* state) {
+  if (container->node->schema != nullptr) {
+    (*position)++;
+    return true;
+  }
 
-    case '0': {
-      if (isdigit(str[1])) {
-        THROW_EXCEPTION(SyntaxError,
-            "Decimal digits after \\0 are not allowed in strings");
+  const Node& key_node = tape.nodes[*position];
+  if (container->object.IsEmpty()) {
+    if (IsPlainKey(key_node)) {
+      Local<String> key;
+      if (!CreateKey(isolate, tape, position, state).ToLocal(&key)) {
         return false;
       }
-      *write_to = 0;
-      break;
+      state->stack.push_back(key);
+      return true;
     }
 
-    default: {
-      if ('0' <= str[0] && str[0] <= '7') {
-        THROW_EXCEPTION(SyntaxError,
-            "Octal escape sequences are not allowed in strings");
-        return false;
-      }
-      *write_to = str[0];
+    container->object = Object::New(isolate);
+    const bool is_defined = DefineProperties(
+        isolate->GetCurrentContext(), container->object,
+        state->stack.data() + container->base, container->count);
+    state->stack.resize(container->base);
+    if (!is_defined) {
+      THROW_EXCEPTION(Error, "Cannot add property to object");
+      return false;
     }
   }
 
-  return true;
+  container->is_index = GetArrayIndex(key_node, &container->index);
+  container->is_proto = IsProtoKey(key_node);
+  if (container->is_index) {
+    (*position)++;
+    return true;
+  }
+  return CreateKey(isolate, tape, position, state).ToLocal(&container->key);
 }
 
-// Parses a hexadecimal number with maximal length of max_len (if is_limited true)
-// into uint32_t. Whether the parsing was successful is determined by the value
-// of `ok`. Resulting size of the value will be outputted in len (if is_limited is
-// false).
-static uint32_t ReadHexNumber(const char* str,
-                              size_t required_len,
-                              bool is_limited,
-                              size_t* len,
-                              bool* ok) {
-  static const int8_t xdigit_table[] = {
-    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, // '0' to '9'
-    -1, -1, -1, -1, -1, -1, -1,   // 0x3A to 0x40
-    10, 11, 12, 13, 14, 15,       // 'A' to 'F'
-    // 'G' to 'Z':
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1,       // 0x5B to 0x60
-    10, 11, 12, 13, 14, 15,       // 'a' to 'f'
-  };
-
-  uint32_t result = 0;
-  uint64_t current_value = 0;
-  size_t current_length = 0;
-  char current_digit;
-
-  *ok = true;
-
-  while (isxdigit(str[current_length])) {
-    current_digit = str[current_length];
-    current_length++;
-    current_value *= 16;
-    current_value += xdigit_table[current_digit - '0'];
-    if (current_value > UINT32_MAX) {
-      *ok = false;
-      return result;
-    }
-    result = current_value;
-    if (is_limited && current_length == required_len) {
-      break;
-    }
+// Adds the `value` to the contents of the `container`, either to the stack of
+// the `state` or as a property of its object.
+static bool AddValue(Isolate*       isolate,
+                     Local<Value>   value,
+                     Container*     container,
+                     CreationState* state) {
+  container->count++;
+  if (container->object.IsEmpty()) {
+    state->stack.push_back(value);
+    return true;
   }
 
-  if (is_limited) {
-    if (current_length < required_len) {
-      *ok = false;
-    }
+  auto context = isolate->GetCurrentContext();
+  Local<Object> object = container->object;
+  Maybe<bool> is_ok = Nothing<bool>();
+  if (container->is_index) {
+    is_ok = object->CreateDataProperty(context, container->index, value);
+  } else if (container->is_proto) {
+    is_ok = object->Set(context, container->key, value);
   } else {
-    if (current_length == 0) {
-      *ok = false;
-    }
-    *len = current_length;
+    is_ok = object->CreateDataProperty(context, container->key, value);
   }
-
-  return result;
+  if (is_ok.IsNothing()) {
+    THROW_EXCEPTION(Error, "Cannot add property to object");
+    return false;
+  }
+  return true;
 }
 
-MaybeLocal<String> ParseKeyInObject(Isolate*    isolate,
-                                    const char* begin,
-                                    const char* end,
-                                    size_t*     size) {
-  *size = end - begin;
-  Local<String> result;
-  if (begin[0] == '\'' || begin[0] == '"') {
-    Type current_type;
-    bool valid = GetType(begin, end, &current_type);
-    if (valid && current_type == Type::kString) {
-      size_t offset;
-      MaybeLocal<Value> key = ParseString(isolate, begin, end, &offset);
-      if (key.IsEmpty()) {
-        return MaybeLocal<String>();
-      }
-      result = key.ToLocalChecked().As<String>();
-      *size = offset;
-      return result;
+// Creates the value described by the node `*position` of the `tape` and the
+// nodes of its contents and advances `position` past them. Nested containers
+// are kept on a stack of their own rather than created recursively, so that
+// the nesting depth is not limited by the size of the native stack.
+static MaybeLocal<Value> CreateValue(Isolate*       isolate,
+                                     const Tape&    tape,
+                                     size_t*        position,
+                                     CreationState* state) {
+  vector<Container> containers;
+  Local<Value> value;
+
+  while (true) {
+    const Node& node = tape.nodes[(*position)++];
+    bool has_value = false;
+
+    if (node.type == NodeType::kArray || node.type == NodeType::kObject) {
+      Container container;
+      container.node = &node;
+      container.length = node.schema != nullptr ?
+          static_cast<uint32_t>(node.schema->keys.size()) : node.size;
+      container.count = 0;
+      container.base = state->stack.size();
+      container.index = 0;
+      container.is_index = false;
+      container.is_proto = false;
+      containers.push_back(container);
     } else {
-      THROW_EXCEPTION(SyntaxError,
-          "Invalid format in object: key is invalid string");
-      return MaybeLocal<String>();
-    }
-  } else {
-    size_t current_length = 0;
-    size_t cp_size;
-    uint32_t cp;
-    bool ok;
-    char* fallback = nullptr;
-    size_t fallback_length;
-    bool is_escape = false;
-    while (current_length < *size) {
-      if (begin[current_length] == '\\' &&
-          begin[current_length + 1] == 'u') {
-        cp = ReadUnicodeEscapeSequence(isolate, begin + current_length + 2,
-                                       &cp_size, &ok);
-        if (!ok) {
-          return MaybeLocal<String>();
-        }
-        cp_size += 2;
-        if (!fallback) {
-          fallback = new char[*size + 1];
-          memcpy(fallback, begin, current_length);
-          fallback_length = current_length;
-        }
-        is_escape = true;
-      } else {
-        cp = Utf8ToCodePoint(begin + current_length, &cp_size);
-        is_escape = false;
-      }
-      if (current_length == 0 ? IsIdStartCodePoint(cp) :
-                                IsIdPartCodePoint(cp)) {
-        if (fallback) {
-          if (!is_escape) {
-            memcpy(fallback + fallback_length, begin + current_length, cp_size);
-            fallback_length += cp_size;
-          } else {
-            size_t fallback_cp_size;
-            CodePointToUtf8(cp, &fallback_cp_size, fallback + fallback_length);
-            fallback_length += fallback_cp_size;
-          }
-        }
-        current_length += cp_size;
-      } else {
-        if (current_length != 0) {
-          if (!fallback) {
-            result = NewFromUtf8OrEmpty(isolate, begin,
-                                        v8::NewStringType::kInternalized,
-                                        static_cast<int>(current_length));
-          } else {
-            result = NewFromUtf8OrEmpty(isolate, fallback,
-                                        v8::NewStringType::kInternalized,
-                                        static_cast<int>(fallback_length));
-          }
-          break;
-        } else {
-          THROW_EXCEPTION(SyntaxError, "Unexpected identifier");
-          return MaybeLocal<String>();
-        }
-      }
+      value = CreateScalar(isolate, node, state);
+      has_value = true;
     }
-    *size = current_length;
-    return result;
-  }
-}
 
-MaybeLocal<Value> ParseValueInObject(Isolate*    isolate,
-                                     const char* begin,
-                                     const char* end,
-                                     size_t*     size) {
-  Type current_type;
-  bool valid = GetType(begin, end, &current_type);
-  if (valid) {
-    return (kParseFunctions[current_type])(isolate, begin, end, size);
-  } else {
-    THROW_EXCEPTION(TypeError, "Invalid type in object");
-    return MaybeLocal<Value>();
-  }
-}
-
-MaybeLocal<Value> ParseObject(Isolate*    isolate,
-                              const char* begin,
-                              const char* end,
-                              size_t*     size) {
-  bool key_mode = true;
-  *size = end - begin;
-  MaybeLocal<String> current_key;
-  MaybeLocal<Value> current_numeric_key;
-  MaybeLocal<Value> current_value;
-  size_t current_length = 0;
-  auto result = Object::New(isolate);
-  bool has_ended = false;
-
-  for (size_t i = 1; i < *size; i++) {
-    if (key_mode) {
-      i += SkipToNextToken(begin + i, end);
-      if (begin[i] == '}') {
-        *size = i + 1;
-        has_ended = true;
-        break;
-      }
-      if (!isdigit(begin[i])) {
-        current_key = ParseKeyInObject(isolate, begin + i, end,
-            &current_length);
-      } else {
-        current_numeric_key = ParseNumber(isolate, begin + i, end,
-            &current_length);
-        current_key = current_numeric_key.IsEmpty() ? MaybeLocal<String>() :
-            current_numeric_key.ToLocalChecked()->ToString(
-                isolate->GetCurrentContext());
-      }
-      if (current_key.IsEmpty()) {
-        return MaybeLocal<Value>();
-      }
-      i += current_length;
-      i += SkipToNextToken(begin + i, end);
-      if (begin[i] != ':') {
-        THROW_EXCEPTION(SyntaxError, "Unexpected token");
+    // Pass the value to the enclosing containers, closing the ones that have
+    // got all of their contents.
+    while (!containers.empty()) {
+      Container* current = &containers.back();
+      if (has_value && !AddValue(isolate, value, current, state)) {
         return MaybeLocal<Value>();
       }
-    } else {
-      i += SkipToNextToken(begin + i, end);
-      if (begin[i] == ',') {
-        THROW_EXCEPTION(SyntaxError, "Value is missing in object");
-        return MaybeLocal<Value>();
-      }
-      current_value = ParseValueInObject(isolate,
-                                         begin + i,
-                                         end,
-                                         &current_length);
-      if (current_value.IsEmpty()) {
-        return current_value;
-      }
-      Local<Value> value = current_value.ToLocalChecked();
-      if (!value->IsUndefined()) {
-        Maybe<bool> is_ok = result->Set(isolate->GetCurrentContext(),
-                                        current_key.ToLocalChecked(),
-                                        value);
-        if (is_ok.IsNothing()) {
-          THROW_EXCEPTION(Error, "Cannot add property to object");
-          return MaybeLocal<Value>();
-        }
+      if (current->count < current->length) {
+        break;
       }
-      i += current_length;
-      i += SkipToNextToken(begin + i, end);
-      if (begin[i] != ',' && begin[i] != '}') {
-        THROW_EXCEPTION(SyntaxError, "Invalid format in object");
+      if (!CloseContainer(isolate, *current, state).ToLocal(&value)) {
         return MaybeLocal<Value>();
-      } else if (begin[i] == '}') {
-        *size = i + 1;
-        has_ended = true;
-        break;
       }
+      has_value = true;
+      containers.pop_back();
     }
-    key_mode = !key_mode;
-  }
-
-  if (!has_ended) {
-    THROW_EXCEPTION(SyntaxError, "Missing closing brace in object");
-    return MaybeLocal<Value>();
-  }
 
-  return result;
-}
-
-MaybeLocal<Value> ParseArray(Isolate*    isolate,
-                             const char* begin,
-                             const char* end,
-                             size_t*     size) {
-  auto array = Array::New(isolate);
-  size_t current_length = 0;
-  *size = end - begin;
-
-  bool is_empty = true;
-  bool has_ended = false;
-
-  size_t current_element = 0;
-  Type current_type;
-
-  for (size_t i = 1; i < *size; i++) {
-    i += SkipToNextToken(begin + i, end);
-    if (is_empty && begin[i] == ']') {  // In case of empty array
-      *size = i + 1;
-      return array;
+    if (containers.empty()) {
+      return value;
     }
 
-    bool valid = GetType(begin + i, end, &current_type);
-    if (valid) {
-      MaybeLocal<Value> t = kParseFunctions[current_type](isolate,
-                                                          begin + i,
-                                                          end,
-                                                          &current_length);
-      if (t.IsEmpty()) {
-        return t;
-      }
-      if (!(current_type == Type::kUndefined && begin[i] == ']')) {
-        Maybe<bool> is_ok = array->Set(isolate->GetCurrentContext(),
-                                       static_cast<uint32_t>(current_element++),
-                                       t.ToLocalChecked());
-        if (is_ok.IsNothing()) {
-          THROW_EXCEPTION(Error, "Cannot add element to array");
-          return MaybeLocal<Value>();
-        }
-        is_empty = false;
-      }
-
-      i += current_length;
-      i += SkipToNextToken(begin + i, end);
-
-      current_length = 0;
-
-      if (begin[i] != ',' && begin[i] != ']') {
-        THROW_EXCEPTION(SyntaxError, "Invalid format in array: missed comma");
-        return MaybeLocal<Value>();
-      } else if (begin[i] == ']') {
-        *size = i + 1;
-        has_ended = true;
-        break;
-      }
-    } else {
-      THROW_EXCEPTION(TypeError, "Invalid type in array");
+    Container* current = &containers.back();
+    if (current->node->type == NodeType::kObject &&
+        !CreateContainerKey(isolate, tape, position, current, state)) {
       return MaybeLocal<Value>();
     }
   }
+}
 
-  if (!has_ended) {
-    THROW_EXCEPTION(SyntaxError, "Missing closing bracket in array");
-    return MaybeLocal<Value>();
-  }
+MaybeLocal<Value> CreateValue(Isolate*       isolate,
+                              const Tape&    tape,
+                              size_t*        position,
+                              const Options& options) {
+  CreationState state;
+  state.options = &options;
+  isolate_data::IsolateData* data = isolate_data::Get(isolate);
+  state.key_cache = &data->key_cache;
+  state.shape_cache = &data->shape_cache;
+  return CreateValue(isolate, tape, position, &state);
+}
 
-  return array;
+Local<Value> CreateError(Isolate* isolate, const tape::Error& error) {
+  Local<String> message = NewFromUtf8OrEmpty(isolate, error.message);
+  Local<Value> exception;
+  switch (error.type) {
+    case tape::kSyntaxError: {
+      exception = Exception::SyntaxError(message);
+      break;
+    }
+    case tape::kTypeError: {
+      exception = Exception::TypeError(message);
+      break;
+    }
+    case tape::kRangeError: {
+      exception = Exception::RangeError(message);
+      break;
+    }
+    default: {
+      exception = Exception::Error(message);
+    }
+  }
+  exception.As<Object>()
+      ->Set(isolate->GetCurrentContext(),
+            NewFromUtf8OrEmpty(isolate, "offset"),
+            Number::New(isolate, static_cast<double>(error.offset)))
+      .FromMaybe(false);
+  return exception;
 }
 
 }  // namespace internal
@@ -10,125 +10,72 @@
 
 #include <v8.h>
 
+#include "tape.h"
+
 namespace mdsf {
 
 namespace parser {
 
+// Strings shorter than that are never created as external strings.
+const std::size_t kMinExternalStringLength = 1024;
+
+// The layout of the objects matching an object schema, built in advance.
+struct ObjectLayout {
+  // A function returning an object literal with the keys of the schema, to
+  // which the values of the properties are passed in the same order. The
+  // objects get all of their properties and their final hidden class at once,
+  // which is faster than defining the properties one by one.
+  v8::Global<v8::Function> create;
+};
+
+struct Options {
+  Options()
+      : external_strings(false),
+        max_depth(tape::kDefaultMaxDepth),
+        validate_utf8(false),
+        schema(nullptr),
+        layouts(nullptr) {}
+
+  // Create strings of ASCII characters longer than kMinExternalStringLength
+  // as external strings, each backed by a copy of its own characters.
+  bool external_strings;
+
+  // Maximal nesting depth of arrays and objects. Neither the tape nor the
+  // values are built recursively, so it is only limited by the memory.
+  std::size_t max_depth;
+
+  // Reject inputs which are not valid UTF-8 instead of letting V8 replace the
+  // invalid sequences with U+FFFD.
+  bool validate_utf8;
+
+  // The schema guiding the parse and the layouts of the object schemas
+  // nested in it indexed by their ids, if there is one. Only synchronous
+  // parsing can be guided by a schema.
+  const tape::Schema* schema;
+  const ObjectLayout* layouts;
+};
+
 // Deserializes a UTF-8 encoded string into a JavaScript value
 // and returns a handle to it.
-v8::Local<v8::Value> Parse(v8::Isolate* isolate,
-                           const char* str,
-                           std::size_t length);
+v8::Local<v8::Value> Parse(v8::Isolate*   isolate,
+                           const char*    str,
+                           std::size_t    length,
+                           const Options& options = Options());
 
 namespace internal {
 
-// Returns count of bytes needed to skip to next token.
-size_t SkipToNextToken(const char* str, const char* end);
-
-// Parses an undefined value from `begin` but never past `end` and returns the
-// parsed JavaScript value. The `size` is incremented by the number of
-// characters the function has used in the string so that the calling side
-// knows where to continue from.
-v8::MaybeLocal<v8::Value> ParseUndefined(v8::Isolate* isolate,
-                                         const char*  begin,
-                                         const char*  end,
-                                         std::size_t* size);
-
-// Parses a null value from `begin` but never past `end` and returns the parsed
-// JavaScript value. The `size` is incremented by the number of characters the
-// function has used in the string so that the calling side knows where to
-// continue from.
-v8::MaybeLocal<v8::Value> ParseNull(v8::Isolate* isolate,
-                                    const char*  begin,
-                                    const char*  end,
-                                    std::size_t* size);
-
-// Parses a boolean value from `begin` but never past `end` and returns the
-// parsed JavaScript value. The `size` is incremented by the number of
-// characters the function has used in the string so that the calling side
-// knows where to continue from.
-v8::MaybeLocal<v8::Value> ParseBool(v8::Isolate* isolate,
-                                    const char*  begin,
-                                    const char*  end,
-                                    std::size_t* size);
-
-// Parses a numeric value from `begin` but never past `end` and returns the
-// parsed JavaScript value. The `size` is incremented by the number of
-// characters the function has used in the string so that the calling side
-// knows where to continue from.
-v8::MaybeLocal<v8::Value> ParseNumber(v8::Isolate* isolate,
-                                      const char*  begin,
-                                      const char*  end,
-                                      std::size_t* size);
-
-// Parses a string value from `begin` but never past `end` and returns the
-// parsed JavaScript value. The `size` is incremented by the number of
-// characters the function has used in the string so that the calling side
-// knows where to continue from.
-v8::MaybeLocal<v8::Value> ParseString(v8::Isolate* isolate,
-                                      const char*  begin,
-                                      const char*  end,
-                                      std::size_t* size);
-
-// Parses an array from `begin` but never past `end` and returns the parsed
-// JavaScript value. The `size` is incremented by the number of characters the
-// function has used in the string so that the calling side knows where to
-// continue from.
-v8::MaybeLocal<v8::Value> ParseArray(v8::Isolate* isolate,
-                                     const char*  begin,
-                                     const char*  end,
-                                     std::size_t* size);
-
-// Parses an object key from `begin` but never past `end` and returns
-// the parsed JavaScript value. The `size` is incremented by the number
-// of characters the function has used in the string so that the calling side
-// knows where to continue from.
-v8::MaybeLocal<v8::String> ParseKeyInObject(v8::Isolate* isolate,
-                                            const char*  begin,
-                                            const char*  end,
-                                            std::size_t* size);
-
-// Parses a value corresponding to key inside object from `begin`
-// but never past `end` and returns the parsed JavaScript value.
-// The `size` is incremented by the number of characters the function has used
-// in the string so that the calling side knows where to continue from.
-v8::MaybeLocal<v8::Value> ParseValueInObject(v8::Isolate* isolate,
-                                             const char*  begin,
-                                             const char*  end,
-                                             std::size_t* size);
-
-// Parses an object from `begin` but never past `end` and returns the parsed
-// JavaScript value. The `size` is incremented by the number of characters the
-// function has used in the string so that the calling side knows where to
-// continue from.
-v8::MaybeLocal<v8::Value> ParseObject(v8::Isolate* isolate,
-                                      const char*  begin,
-                                      const char*  end,
-                                      std::size_t* size);
-
-// Parses a decimal number, either integer or float.
-v8::MaybeLocal<v8::Value> ParseDecimalNumber(v8::Isolate* isolate,
-                                             const char*  begin,
-                                             const char*  end,
-                                             std::size_t* size,
-                                             bool         negate_result);
-
-// Parses an integer number in arbitrary base without prefixes.
-v8::Local<v8::Value> ParseIntegerNumber(v8::Isolate* isolate,
-                                        const char*  begin,
-                                        const char*  end,
-                                        std::size_t* size,
-                                        int          base,
-                                        bool         negate_result);
-
-// Parses an integer number, which is too big to be parsed using
-// ParseIntegerNumber, in arbitrary base without prefixes.
-v8::Local<v8::Value> ParseBigIntegerNumber(v8::Isolate* isolate,
-                                           const char*  begin,
-                                           const char*  end,
-                                           std::size_t* size,
-                                           int          base,
-                                           bool         negate_result);
+// Creates the JavaScript value described by the node `*position` of the
+// `tape` and the nodes of its contents. The `position` is advanced past them
+// so that the calling side knows where to continue from.
+v8::MaybeLocal<v8::Value> CreateValue(v8::Isolate*      isolate,
+                                      const tape::Tape& tape,
+                                      std::size_t*      position,
+                                      const Options&    options = Options());
+
+// Creates the JavaScript exception described by `error`, which has the
+// offset at which the error was found as its `offset` property.
+v8::Local<v8::Value> CreateError(v8::Isolate* isolate,
+                                 const tape::Error& error);
 
 }  // namespace internal
 
@@ -0,0 +1,311 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "schema_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+
+#include "common.h"
+#include "parser.h"
+#include "tape.h"
+
+using std::size_t;
+using std::string;
+using std::to_string;
+using std::strcmp;
+using std::uint32_t;
+using std::unique_ptr;
+
+using v8::Array;
+using v8::Context;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::NewStringType;
+using v8::Object;
+using v8::Script;
+using v8::String;
+using v8::Uint8Array;
+using v8::Value;
+
+using mdsf::tape::Schema;
+
+namespace mdsf {
+
+namespace schema_parser {
+
+// Returns true if the UTF-8 encoded `key` consists of ASCII characters only.
+static bool IsAscii(const string& key) {
+  for (char c : key) {
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Appends the UTF-8 encoded `text` to the `source` code as a string literal.
+static void AppendStringLiteral(const string& text, string* source) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  *source += '"';
+  for (char c : text) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      *source += '\\';
+      *source += c;
+    } else if (byte < 0x20) {
+      *source += "\\u00";
+      *source += kHexDigits[byte >> 4];
+      *source += kHexDigits[byte & 0xF];
+    } else {
+      *source += c;
+    }
+  }
+  *source += '"';
+}
+
+static bool IsIdentifierStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+         c == '$';
+}
+
+// Returns true if the `key` is an identifier of ASCII characters, which
+// may be written without quotes.
+static bool IsAsciiIdentifier(const string& key) {
+  if (key.empty() || !IsIdentifierStart(key[0])) {
+    return false;
+  }
+  for (char c : key) {
+    if (!IsIdentifierStart(c) && !(c >= '0' && c <= '9')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SchemaParser::Init(Local<Object> target) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+
+  Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+  Local<String> name = NewFromUtf8OrEmpty(isolate, "SchemaParser");
+  tpl->SetClassName(name);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "parse", Parse);
+
+  Local<Function> constructor;
+  if (tpl->GetFunction(context).ToLocal(&constructor)) {
+    target->Set(context, name, constructor).FromMaybe(false);
+  }
+}
+
+void SchemaParser::New(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args.IsConstructCall()) {
+    THROW_EXCEPTION(TypeError, "SchemaParser must be called with new");
+    return;
+  }
+  if (args.Length() != 1) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+
+  unique_ptr<SchemaParser> parser(new SchemaParser());
+  if (!parser->Compile(isolate, args[0], 0, &parser->root_)) {
+    return;
+  }
+  parser.release()->Wrap(args.This());
+  args.GetReturnValue().Set(args.This());
+}
+
+void SchemaParser::Parse(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() != 1) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+
+  HandleScope scope(isolate);
+
+  SchemaParser* parser = ObjectWrap::Unwrap<SchemaParser>(args.Holder());
+  parser::Options options;
+  options.schema = parser->root_;
+  options.layouts = parser->layouts_.data();
+
+  Local<Value> result;
+
+  if (args[0]->IsString()) {
+    String::Utf8Value str(
+#if NODE_MODULE_VERSION >= 57
+        isolate,
+#endif
+        args[0]
+    );
+    result = parser::Parse(isolate, *str, str.length(), options);
+  } else if (args[0]->IsUint8Array()) {
+    Local<Uint8Array> buf = args[0].As<Uint8Array>();
+    void* data = buf->Buffer()->GetContents().Data();
+    const char* str = static_cast<const char*>(data) + buf->ByteOffset();
+    result = parser::Parse(isolate, str, buf->ByteLength(), options);
+  } else {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return;
+  }
+
+  args.GetReturnValue().Set(result);
+}
+
+bool SchemaParser::Compile(Isolate*       isolate,
+                           Local<Value>   value,
+                           size_t         depth,
+                           const Schema** schema) {
+  if (depth >= tape::kDefaultMaxDepth) {
+    THROW_EXCEPTION(RangeError, "Maximum nesting depth exceeded");
+    return false;
+  }
+
+  if (value->IsString()) {
+    String::Utf8Value type(
+#if NODE_MODULE_VERSION >= 57
+        isolate,
+#endif
+        value
+    );
+    if (strcmp(*type, "string") != 0 && strcmp(*type, "number") != 0 &&
+        strcmp(*type, "boolean") != 0 && strcmp(*type, "any") != 0) {
+      THROW_EXCEPTION(TypeError, "Invalid schema");
+      return false;
+    }
+    *schema = nullptr;
+    return true;
+  }
+
+  if (value->IsArray()) {
+    auto context = isolate->GetCurrentContext();
+    Local<Array> array = value.As<Array>();
+    Local<Value> item;
+    const Schema* item_schema;
+    if (array->Length() != 1) {
+      THROW_EXCEPTION(TypeError,
+                      "Array schema must contain exactly one item schema");
+      return false;
+    }
+    if (!array->Get(context, 0).ToLocal(&item) ||
+        !Compile(isolate, item, depth + 1, &item_schema)) {
+      return false;
+    }
+    if (item_schema == nullptr) {
+      // Arrays of values of any layout are of any layout themselves.
+      *schema = nullptr;
+      return true;
+    }
+    schemas_.emplace_back(new Schema());
+    Schema* array_schema = schemas_.back().get();
+    array_schema->is_array = true;
+    array_schema->values.push_back(item_schema);
+    *schema = array_schema;
+    return true;
+  }
+
+  if (value->IsObject() && !value->IsFunction()) {
+    schemas_.emplace_back(new Schema());
+    Schema* object_schema = schemas_.back().get();
+    *schema = object_schema;
+    return CompileObject(isolate, value.As<Object>(), depth, object_schema);
+  }
+
+  THROW_EXCEPTION(TypeError, "Invalid schema");
+  return false;
+}
+
+bool SchemaParser::CompileObject(Isolate*      isolate,
+                                 Local<Object> value,
+                                 size_t        depth,
+                                 Schema*       schema) {
+  auto context = isolate->GetCurrentContext();
+  Local<Array> names;
+  if (!value->GetOwnPropertyNames(context).ToLocal(&names)) {
+    return false;
+  }
+
+  const uint32_t length = names->Length();
+  schema->id = layouts_.size();
+  layouts_.emplace_back();
+  string parameters;
+  string properties;
+
+  for (uint32_t i = 0; i < length; i++) {
+    HandleScope scope(isolate);
+    Local<Value> name;
+    Local<String> key;
+    Local<Value> field;
+    const Schema* field_schema;
+    if (!names->Get(context, i).ToLocal(&name) ||
+        !name->ToString(context).ToLocal(&key) ||
+        !value->Get(context, key).ToLocal(&field) ||
+        !Compile(isolate, field, depth + 1, &field_schema)) {
+      return false;
+    }
+
+    String::Utf8Value text(
+#if NODE_MODULE_VERSION >= 57
+        isolate,
+#endif
+        key
+    );
+    Schema::Key schema_key;
+    schema_key.text.assign(*text, text.length());
+    if ((!schema_key.text.empty() && schema_key.text[0] >= '0' &&
+         schema_key.text[0] <= '9') ||
+        schema_key.text == "__proto__") {
+      THROW_EXCEPTION(TypeError, "Invalid key in schema");
+      return false;
+    }
+    schema_key.is_ascii = IsAscii(schema_key.text);
+    schema_key.is_identifier = IsAsciiIdentifier(schema_key.text);
+
+    const string parameter = "v" + to_string(i);
+    if (i > 0) {
+      parameters += ',';
+      properties += ',';
+    }
+    parameters += parameter;
+    AppendStringLiteral(schema_key.text, &properties);
+    properties += ':' + parameter;
+
+    schema->keys.push_back(schema_key);
+    schema->values.push_back(field_schema);
+  }
+
+  const string source =
+      "(function(" + parameters + "){return {" + properties + "};})";
+  Local<Script> script;
+  Local<Value> create;
+  if (!Script::Compile(context, NewFromUtf8OrEmpty(
+                                    isolate, source.data(),
+                                    NewStringType::kNormal,
+                                    static_cast<int>(source.size())))
+           .ToLocal(&script) ||
+      !script->Run(context).ToLocal(&create)) {
+    return false;
+  }
+  layouts_[schema->id].create.Reset(isolate, create.As<Function>());
+  return true;
+}
+
+}  // namespace schema_parser
+
+}  // namespace mdsf
@@ -0,0 +1,72 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_SCHEMA_PARSER_H_
+#define SRC_SCHEMA_PARSER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <node_object_wrap.h>
+#include <v8.h>
+
+#include "parser.h"
+#include "tape.h"
+
+namespace mdsf {
+
+namespace schema_parser {
+
+// A parser of values of a known layout, exposed to JavaScript as the
+// SchemaParser class. The schema is converted into a tape::Schema tree, and
+// a function creating the objects of every object schema in it is compiled
+// once, so that the keys of the objects matching the schema are checked by
+// comparing bytes and the objects are created without looking their keys up
+// in the caches and defining their properties one by one. The values which
+// don't match the schema are parsed as usual.
+class SchemaParser : public node::ObjectWrap {
+ public:
+  // Adds the SchemaParser constructor to the `target` object.
+  static void Init(v8::Local<v8::Object> target);
+
+ private:
+  SchemaParser() : root_(nullptr) {}
+
+  // new SchemaParser(schema) where the `schema` is made up of:
+  //   'string', 'number', 'boolean', 'any' - values of any layout
+  //   [itemSchema] - arrays of items of the `itemSchema`
+  //   { key: fieldSchema, ... } - objects with these keys in this order
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // schemaParser.parse(data) parses the string or Uint8Array `data`.
+  static void Parse(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Builds the schema described by `value` with all of the nested ones and
+  // writes it to `schema`, or nullptr for values of any layout. Returns false
+  // if an exception has been thrown.
+  bool Compile(v8::Isolate*        isolate,
+               v8::Local<v8::Value> value,
+               std::size_t          depth,
+               const tape::Schema** schema);
+
+  // Builds the object schema described by `value` and its layout.
+  bool CompileObject(v8::Isolate*          isolate,
+                     v8::Local<v8::Object> value,
+                     std::size_t           depth,
+                     tape::Schema*         schema);
+
+  // The schema of the values, or nullptr if they may be of any layout.
+  const tape::Schema* root_;
+
+  // Storage of all of the schemas and the layouts of the object schemas
+  // indexed by their ids.
+  std::vector<std::unique_ptr<tape::Schema>> schemas_;
+  std::vector<parser::ObjectLayout> layouts_;
+};
+
+}  // namespace schema_parser
+
+}  // namespace mdsf
+
+#endif  // SRC_SCHEMA_PARSER_H_
@@ -0,0 +1,1239 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "serializer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include "common.h"
+#include "isolate_data.h"
+#include "simd_utils.h"
+#include "unicode_utils.h"
+
+using std::free;
+using std::int64_t;
+using std::malloc;
+using std::memcpy;
+using std::realloc;
+using std::size_t;
+using std::string;
+using std::strlen;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using std::vector;
+
+using v8::Array;
+using v8::Context;
+using v8::Function;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Just;
+using v8::Local;
+using v8::Maybe;
+using v8::MaybeLocal;
+using v8::NewStringType;
+using v8::Nothing;
+using v8::Number;
+using v8::Object;
+using v8::String;
+using v8::Uint8Array;
+using v8::Value;
+
+using mdsf::simd_utils::FindCharacterToEscape;
+using mdsf::simd_utils::NarrowAscii;
+using mdsf::unicode_utils::CodePointToUtf8;
+using mdsf::unicode_utils::Utf8ToUtf16;
+
+namespace mdsf {
+
+namespace serializer {
+
+const size_t KeyCache::kCapacity;
+const size_t KeyCache::kMaxKeyLength;
+
+KeyCache::KeyCache() : entries_(new Entry[kCapacity]) {
+  for (size_t i = 0; i < kCapacity; i++) {
+    entries_[i].length = 0;
+  }
+}
+
+bool KeyCache::Find(Local<String> key,
+                    const char**  text,
+                    size_t*       length) const {
+  const Entry& entry =
+      entries_[static_cast<uint32_t>(key->GetIdentityHash()) &
+               (kCapacity - 1)];
+  if (entry.key.IsEmpty() || entry.key != key) {
+    return false;
+  }
+  *text = entry.text;
+  *length = entry.length;
+  return true;
+}
+
+void KeyCache::Add(Isolate*      isolate,
+                   Local<String> key,
+                   const char*   text,
+                   size_t        length) {
+  if (length > kMaxKeyLength) {
+    return;
+  }
+  Entry& entry =
+      entries_[static_cast<uint32_t>(key->GetIdentityHash()) &
+               (kCapacity - 1)];
+  entry.length = static_cast<uint32_t>(length);
+  memcpy(entry.text, text, length);
+  entry.key.Reset(isolate, key);
+}
+
+namespace {
+
+// Count of characters `space` is cut to.
+const int kMaxSpaceLength = 10;
+
+// Maximal length of a number printed by V8, e.g. -1.2345678901234567e-100.
+const size_t kMaxNumberLength = 24;
+
+// Integers smaller than that in absolute value are exactly representable as
+// doubles and are printed by the serializer itself.
+const double kMaxSafeInteger = 9007199254740992.0;
+
+const char kHexDigits[] = "0123456789abcdef";
+
+// Maximal count of bytes a UTF-16 code unit takes in a string literal, which
+// is the size of its escape sequence, e.g. \u001f.
+const size_t kMaxEscapedCharacterSize = 6;
+
+// Size of the buffer the serializer gathers the pieces of escaped strings in.
+const size_t kEscapeBatchSize = 256;
+
+// Size of the memory the output allocates first.
+const size_t kMinOutputCapacity = 256;
+
+const char kBase64Digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Writes the decimal digits of `value` backwards ending at `end` and returns
+// a pointer to the first of them.
+char* FormatUnsigned(uint64_t value, char* end) {
+  char* pos = end;
+  do {
+    *--pos = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  return pos;
+}
+
+// Returns true if the key consisting of `chars` matches /^[a-zA-Z_$][\w$]*$/
+// and thus can be written without quotes.
+template <typename Char>
+bool IsPlainKey(const Char* chars, size_t length) {
+  if (length == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    const Char c = chars[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+          c == '$' || (i > 0 && c >= '0' && c <= '9'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes the \uXXXX escape sequence of the UTF-16 code unit `c` into `out`
+// and returns a pointer past it.
+inline char* WriteUnicodeEscape(uint32_t c, char* out) {
+  *out++ = '\\';
+  *out++ = 'u';
+  *out++ = kHexDigits[c >> 12];
+  *out++ = kHexDigits[(c >> 8) & 0xF];
+  *out++ = kHexDigits[(c >> 4) & 0xF];
+  *out++ = kHexDigits[c & 0xF];
+  return out;
+}
+
+// Writes the character at `*index` of the `length` characters at `chars`
+// into `out` the way it appears in a string literal, encoded as UTF-8 or
+// escaped, advances `*index` past it and returns a pointer past the output,
+// which takes at most kMaxEscapedCharacterSize bytes. Surrogate pairs are
+// encoded together.
+template <typename Char>
+inline char* EscapeCharacter(const Char* chars,
+                             size_t      length,
+                             size_t*     index,
+                             char*       out) {
+  uint32_t c = chars[(*index)++];
+  if (c >= 0x80) {
+    if (c < 0x800) {
+      *out++ = static_cast<char>(0xC0 | (c >> 6));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0xD800 || c >= 0xE000) {
+      *out++ = static_cast<char>(0xE0 | (c >> 12));
+      *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0xDC00 && *index < length && chars[*index] >= 0xDC00 &&
+               chars[*index] < 0xE000) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (chars[(*index)++] - 0xDC00);
+      *out++ = static_cast<char>(0xF0 | (c >> 18));
+      *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      // Lone surrogates are escaped as JSON.stringify() does since they
+      // can't be encoded in UTF-8.
+      out = WriteUnicodeEscape(c, out);
+    }
+    return out;
+  }
+
+  *out++ = '\\';
+  switch (c) {
+    case '\'':
+    case '"':
+    case '\\':
+      *out++ = static_cast<char>(c);
+      break;
+    case '\b':
+      *out++ = 'b';
+      break;
+    case '\f':
+      *out++ = 'f';
+      break;
+    case '\n':
+      *out++ = 'n';
+      break;
+    case '\r':
+      *out++ = 'r';
+      break;
+    case '\t':
+      *out++ = 't';
+      break;
+    default:
+      out = WriteUnicodeEscape(c, out - 1);
+  }
+  return out;
+}
+
+// Returns true for the values the serializer omits, which are functions,
+// symbols and BigInts.
+inline bool IsOmitted(Local<Value> value) {
+  return !(value->IsObject() || value->IsString() || value->IsNumber() ||
+           value->IsBoolean() || value->IsNull() || value->IsUndefined()) ||
+         value->IsFunction();
+}
+
+// Copies `length` ASCII characters into `out`, one byte per character.
+inline void CopyAscii(const uint8_t* chars, size_t length, char* out) {
+  memcpy(out, chars, length);
+}
+
+inline void CopyAscii(const uint16_t* chars, size_t length, char* out) {
+  NarrowAscii(chars, chars + length, out);
+}
+
+// The bytes the serializer writes. They go into memory lent by the caller
+// while they fit there, and into memory allocated by the output itself with
+// malloc() otherwise, which can be handed over to a Buffer.
+class Output {
+ public:
+  Output() : data_(nullptr), size_(0), capacity_(0), is_lent_(false) {}
+  ~Output() {
+    if (!is_lent_) {
+      free(data_);
+    }
+  }
+
+  Output(const Output&) = delete;
+  Output& operator=(const Output&) = delete;
+
+  // Makes the output start in the `capacity` bytes at `data`, which must
+  // stay valid as long as the output is written.
+  void Lend(char* data, size_t capacity) {
+    data_ = data;
+    capacity_ = capacity;
+    is_lent_ = true;
+  }
+
+  // Passes the memory allocated by the output, shrunk to its size, to the
+  // caller, who must free() it.
+  char* Release() {
+    char* data = data_;
+    if (size_ < capacity_ && size_ != 0) {
+      data = static_cast<char*>(realloc(data_, size_));
+      if (data == nullptr) {
+        data = data_;
+      }
+    }
+    data_ = nullptr;
+    size_ = capacity_ = 0;
+    return data;
+  }
+
+  char* data() { return data_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool is_lent() const { return is_lent_; }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_) {
+      Grow(capacity);
+    }
+  }
+
+  // Unlike std::string::resize(), leaves the bytes added uninitialized for
+  // the caller to write.
+  void resize(size_t size) {
+    reserve(size);
+    size_ = size;
+  }
+
+  void append(const char* data, size_t length) {
+    reserve(size_ + length);
+    memcpy(data_ + size_, data, length);
+    size_ += length;
+  }
+
+  Output& operator+=(char c) {
+    if (size_ == capacity_) {
+      Grow(size_ + 1);
+    }
+    data_[size_++] = c;
+    return *this;
+  }
+
+  Output& operator+=(const char* str) {
+    append(str, strlen(str));
+    return *this;
+  }
+
+  Output& operator+=(const string& str) {
+    append(str.data(), str.size());
+    return *this;
+  }
+
+ private:
+  void Grow(size_t min_capacity);
+
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+  bool is_lent_;
+};
+
+void Output::Grow(size_t min_capacity) {
+  size_t capacity = capacity_ * 2;
+  if (capacity < min_capacity) {
+    capacity = min_capacity;
+  }
+  if (capacity < kMinOutputCapacity) {
+    capacity = kMinOutputCapacity;
+  }
+
+  char* data;
+  if (is_lent_) {
+    data = static_cast<char*>(malloc(capacity));
+    if (data != nullptr && size_ != 0) {
+      memcpy(data, data_, size_);
+    }
+  } else {
+    data = static_cast<char*>(realloc(data_, capacity));
+  }
+  // Running out of memory is fatal the same way as it is for std::string
+  // with exceptions disabled.
+  if (data == nullptr) {
+    std::abort();
+  }
+  data_ = data;
+  capacity_ = capacity;
+  is_lent_ = false;
+}
+
+class Serializer {
+ public:
+  explicit Serializer(Isolate* isolate);
+
+  // Sets the indentation the same way as lib/stringify.js normalizes its
+  // `space` argument. Returns false if an exception has been thrown.
+  bool SetSpace(Local<Value> space);
+
+  // Sets the replacer function or the list of keys to keep.
+  // Returns false if an exception has been thrown.
+  bool SetReplacer(Local<Value> replacer);
+
+  // Appends the serialized `value` to the output.
+  // Returns false if an exception has been thrown.
+  bool Serialize(Local<Value> value);
+
+  // Adds the estimated size of the serialized `value` to `size`.
+  // Returns false if an exception has been thrown.
+  bool EstimateSize(Local<Value> value, size_t* size);
+
+  Output* output() { return &output_; }
+  bool is_ascii() const { return is_ascii_; }
+
+ private:
+  // Appends `value` which is the property `key` of the `holder`, or its
+  // element `index` if `key` is empty. The `holder` is empty for the value
+  // being serialized itself.
+  bool SerializeValue(Local<Value>  value,
+                      Local<String> key,
+                      uint32_t      index,
+                      Local<Object> holder);
+
+  // Replaces `*value` with what the `toMDSF()` or `toJSON()` method and the
+  // replacer return for it. The arguments are the same as SerializeValue()
+  // takes. Returns false if an exception has been thrown.
+  bool ResolveValue(Local<Value>* value,
+                    Local<String> key,
+                    uint32_t      index,
+                    Local<Object> holder);
+
+  // Appends the resolved `value`.
+  bool WriteValue(Local<Value> value);
+  bool SerializeArray(Local<Array> array);
+  bool SerializeObject(Local<Object> object);
+
+  // Gets the own enumerable string keys of the `object` like Object.keys().
+  // Returns false if an exception has been thrown.
+  bool GetKeys(Local<Object> object, Local<Array>* keys);
+
+  // Gets the `toMDSF()` or `toJSON()` method of the `object` the same way as
+  // lib/stringify.js does, or undefined if there is none to call.
+  // Returns false if an exception has been thrown.
+  bool GetMethod(Local<Object> object, Local<Value>* method);
+
+  // Increases the nesting depth, throwing a RangeError if it gets larger
+  // than kMaxDepth.
+  bool EnterContainer();
+
+  void WriteNumber(double value);
+  bool WriteNumber(Local<Value> number);
+  void WriteString(Local<String> str);
+  void WriteKey(Local<String> key);
+  void WriteBuffer(Local<Value> buffer);
+
+  // Appends the characters quoted and escaped the same way as
+  // JSON.stringify() does, with single quotes escaped as well.
+  template <typename Char>
+  void WriteEscaped(const Char* chars, size_t length);
+
+  // Appends a run of ASCII characters.
+  void WriteAscii(const uint8_t* chars, size_t length);
+  void WriteAscii(const uint16_t* chars, size_t length);
+
+  // Reads the characters of `str` into one_byte_chars_ and returns true if
+  // it is a one-byte string, or into two_byte_chars_ and returns false
+  // otherwise.
+  bool ReadString(Local<String> str);
+
+  Local<String> GetKey(Local<String> key, uint32_t index);
+  bool IsReplacerKey(Local<String> key);
+  bool IsBuffer(Local<Value> value);
+
+  Isolate* isolate_;
+  isolate_data::IsolateData* data_;
+  Local<Context> context_;
+  Local<String> to_mdsf_;
+  Local<String> to_json_;
+
+  Local<Function> replacer_function_;
+  vector<Local<String>> replacer_keys_;
+  bool has_replacer_keys_;
+
+  string space_;
+  string indent_;
+  size_t depth_;
+
+  Output output_;
+  // Whether the output is ASCII, so that it can be turned into a one-byte
+  // string without decoding.
+  bool is_ascii_;
+  vector<uint8_t> one_byte_chars_;
+  vector<uint16_t> two_byte_chars_;
+};
+
+Serializer::Serializer(Isolate* isolate)
+    : isolate_(isolate),
+      data_(isolate_data::Get(isolate)),
+      context_(isolate->GetCurrentContext()),
+      has_replacer_keys_(false),
+      depth_(0),
+      is_ascii_(true) {
+  if (data_->to_mdsf_name.IsEmpty()) {
+    data_->to_mdsf_name.Reset(
+        isolate, NewFromOneByteOrEmpty(isolate, "toMDSF",
+                                       NewStringType::kInternalized));
+    data_->to_json_name.Reset(
+        isolate, NewFromOneByteOrEmpty(isolate, "toJSON",
+                                       NewStringType::kInternalized));
+  }
+  to_mdsf_ = Local<String>::New(isolate, data_->to_mdsf_name);
+  to_json_ = Local<String>::New(isolate, data_->to_json_name);
+}
+
+bool Serializer::SetSpace(Local<Value> space) {
+#if NODE_MODULE_VERSION >= 67
+  if (!space->BooleanValue(isolate_)) {
+    return true;
+  }
+#else
+  if (!space->BooleanValue(context_).FromJust()) {
+    return true;
+  }
+#endif
+
+  if (space->IsNumberObject()) {
+    if (!space->ToNumber(context_).ToLocal(&space)) {
+      return false;
+    }
+  } else if (space->IsStringObject()) {
+    if (!space->ToString(context_).ToLocal(&space)) {
+      return false;
+    }
+  }
+
+  if (space->IsNumber()) {
+    const double count = space.As<Number>()->Value();
+    if (std::isfinite(count) && count == std::floor(count) && count > 0) {
+      space_.assign(count < kMaxSpaceLength ? static_cast<size_t>(count) :
+                                              kMaxSpaceLength,
+                    ' ');
+    }
+  } else if (space->IsString()) {
+    Local<String> str = space.As<String>();
+    uint16_t chars[kMaxSpaceLength];
+    const int length =
+        str->Length() < kMaxSpaceLength ? str->Length() : kMaxSpaceLength;
+    str->Write(
+#if NODE_MODULE_VERSION >= 67
+        isolate_,
+#endif
+        chars, 0, length, String::NO_NULL_TERMINATION);
+
+    for (int i = 0; i < length; i++) {
+      uint32_t c = chars[i];
+      if (c >= 0xD800 && c < 0xDC00 && i + 1 < length &&
+          chars[i + 1] >= 0xDC00 && chars[i + 1] < 0xE000) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (chars[++i] - 0xDC00);
+      }
+      char utf8[4];
+      size_t size;
+      CodePointToUtf8(c, &size, utf8);
+      space_.append(utf8, size);
+      if (c >= 0x80) {
+        is_ascii_ = false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Serializer::SetReplacer(Local<Value> replacer) {
+  if (replacer->IsFunction()) {
+    replacer_function_ = replacer.As<Function>();
+    return true;
+  }
+  if (!replacer->IsArray()) {
+    return true;
+  }
+
+  has_replacer_keys_ = true;
+  Local<Array> array = replacer.As<Array>();
+  const uint32_t length = array->Length();
+  for (uint32_t i = 0; i < length; i++) {
+    Local<Value> element;
+    if (!array->Get(context_, i).ToLocal(&element)) {
+      return false;
+    }
+    if (element->IsString()) {
+      replacer_keys_.push_back(element.As<String>());
+    } else if (element->IsNumber() || element->IsNumberObject() ||
+               element->IsStringObject()) {
+      Local<String> key;
+      if (!element->ToString(context_).ToLocal(&key)) {
+        return false;
+      }
+      replacer_keys_.push_back(key);
+    }
+  }
+  return true;
+}
+
+bool Serializer::Serialize(Local<Value> value) {
+  return SerializeValue(value, String::Empty(isolate_), 0, Local<Object>());
+}
+
+bool Serializer::EstimateSize(Local<Value> value, size_t* size) {
+  if (value->IsString()) {
+    *size += value.As<String>()->Utf8Length(
+#if NODE_MODULE_VERSION >= 67
+                 isolate_
+#endif
+                 ) +
+             2;
+  } else if (value->IsNumber()) {
+    const double number = value.As<Number>()->Value();
+    if (number == std::floor(number) && std::fabs(number) < kMaxSafeInteger) {
+      char digits[20];
+      char* end = digits + sizeof(digits);
+      *size += end - FormatUnsigned(static_cast<uint64_t>(std::fabs(number)),
+                                    end) +
+               (number < 0 ? 1 : 0);
+    } else {
+      *size += kMaxNumberLength;
+    }
+  } else if (value->IsNumberObject()) {
+    *size += kMaxNumberLength;
+  } else if (value->IsBoolean() || value->IsBooleanObject()) {
+    *size += 5;
+  } else if (value->IsNull()) {
+    *size += 4;
+  } else if (value->IsUndefined()) {
+    *size += 9;
+  } else if (value->IsStringObject()) {
+    return EstimateSize(value.As<v8::StringObject>()->ValueOf(), size);
+  } else if (IsBuffer(value)) {
+    *size += (node::Buffer::Length(value) + 2) / 3 * 4 + 2;
+  } else if (value->IsObject() && !value->IsFunction()) {
+    if (!EnterContainer()) {
+      return false;
+    }
+    const bool is_array = value->IsArray();
+    Local<Object> object = value.As<Object>();
+    Local<Array> keys;
+    if (!is_array && !GetKeys(object, &keys)) {
+      return false;
+    }
+
+    const uint32_t length =
+        is_array ? value.As<Array>()->Length() : keys->Length();
+    *size += length > 0 ? length + 1 : 2;
+    for (uint32_t i = 0; i < length; i++) {
+      HandleScope scope(isolate_);
+      Local<Value> key;
+      Local<Value> element;
+      if (is_array) {
+        if (!object->Get(context_, i).ToLocal(&element)) {
+          return false;
+        }
+        if (element->IsUndefined()) {
+          continue;
+        }
+      } else {
+        if (!keys->Get(context_, i).ToLocal(&key) ||
+            !object->Get(context_, key).ToLocal(&element) ||
+            !EstimateSize(key, size)) {
+          return false;
+        }
+      }
+      if (!EstimateSize(element, size)) {
+        return false;
+      }
+    }
+    depth_--;
+  }
+  return true;
+}
+
+bool Serializer::SerializeValue(Local<Value>  value,
+                                Local<String> key,
+                                uint32_t      index,
+                                Local<Object> holder) {
+  return ResolveValue(&value, key, index, holder) && WriteValue(value);
+}
+
+bool Serializer::ResolveValue(Local<Value>* value,
+                              Local<String> key,
+                              uint32_t      index,
+                              Local<Object> holder) {
+  if ((*value)->IsObject() && !(*value)->IsFunction()) {
+    Local<Object> object = value->As<Object>();
+    Local<Value> method;
+    if (!GetMethod(object, &method)) {
+      return false;
+    }
+    if (method->IsFunction()) {
+      Local<Value> argv[] = {GetKey(key, index)};
+      if (!method.As<Function>()->Call(context_, object, 1, argv)
+               .ToLocal(value)) {
+        return false;
+      }
+    }
+  }
+
+  if (!replacer_function_.IsEmpty()) {
+    Local<Object> receiver = holder;
+    if (receiver.IsEmpty()) {
+      receiver = Object::New(isolate_);
+      if (receiver
+              ->CreateDataProperty(context_, String::Empty(isolate_), *value)
+              .IsNothing()) {
+        return false;
+      }
+    }
+    Local<Value> argv[] = {GetKey(key, index), *value};
+    if (!replacer_function_->Call(context_, receiver, 2, argv)
+             .ToLocal(value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Serializer::WriteValue(Local<Value> value) {
+  if (value->IsString()) {
+    WriteString(value.As<String>());
+  } else if (value->IsNumber()) {
+    WriteNumber(value.As<Number>()->Value());
+  } else if (value->IsBoolean()) {
+    output_ += value->IsTrue() ? "true" : "false";
+  } else if (value->IsNull()) {
+    output_ += "null";
+  } else if (value->IsUndefined()) {
+    output_ += "undefined";
+  } else if (value->IsArray()) {
+    return SerializeArray(value.As<Array>());
+  } else if (IsBuffer(value)) {
+    WriteBuffer(value);
+  } else if (!IsOmitted(value)) {
+    return SerializeObject(value.As<Object>());
+  }
+  return true;
+}
+
+bool Serializer::SerializeArray(Local<Array> array) {
+  if (!EnterContainer()) {
+    return false;
+  }
+  output_ += '[';
+
+  const size_t start_indent_size = indent_.size();
+  indent_ += space_;
+
+  const uint32_t length = array->Length();
+  bool is_empty = true;
+  for (uint32_t index = 0; index < length; index++) {
+    HandleScope scope(isolate_);
+    Local<Value> element;
+    if (!array->Get(context_, index).ToLocal(&element)) {
+      return false;
+    }
+
+    if (!element->IsUndefined()) {
+      if (!space_.empty()) {
+        output_ += '\n';
+        output_ += indent_;
+      }
+      if (!SerializeValue(element, Local<String>(), index, array)) {
+        return false;
+      }
+      is_empty = false;
+    }
+
+    if (index != length - 1) {
+      output_ += ',';
+      is_empty = false;
+    }
+  }
+
+  indent_.resize(start_indent_size);
+  if (!space_.empty() && !is_empty) {
+    output_ += '\n';
+    output_ += indent_;
+  }
+  output_ += ']';
+  depth_--;
+  return true;
+}
+
+bool Serializer::SerializeObject(Local<Object> object) {
+  // Wrapper objects are serialized as the primitive values they are
+  // converted to, which is always `true` for Boolean objects.
+  if (object->IsNumberObject()) {
+    return WriteNumber(object);
+  } else if (object->IsStringObject()) {
+    Local<String> str;
+    if (!object->ToString(context_).ToLocal(&str)) {
+      return false;
+    }
+    WriteString(str);
+    return true;
+  } else if (object->IsBooleanObject()) {
+    output_ += "true";
+    return true;
+  }
+
+  Local<Array> keys;
+  if (!GetKeys(object, &keys)) {
+    return false;
+  }
+
+  if (!EnterContainer()) {
+    return false;
+  }
+  output_ += '{';
+
+  const size_t start_indent_size = indent_.size();
+  indent_ += space_;
+
+  const uint32_t keys_count = keys->Length();
+  bool is_empty = true;
+  for (uint32_t i = 0; i < keys_count; i++) {
+    HandleScope scope(isolate_);
+    Local<Value> key_value;
+    if (!keys->Get(context_, i).ToLocal(&key_value)) {
+      return false;
+    }
+    Local<String> key = key_value.As<String>();
+    if (has_replacer_keys_ && !IsReplacerKey(key)) {
+      continue;
+    }
+
+    Local<Value> value;
+    if (!object->Get(context_, key).ToLocal(&value)) {
+      return false;
+    }
+
+    // Properties whose values are omitted or undefined are left out
+    // altogether, so nothing is written for them speculatively.
+    if (!ResolveValue(&value, key, 0, object)) {
+      return false;
+    }
+    if (value->IsUndefined() || IsOmitted(value)) {
+      continue;
+    }
+
+    if (!is_empty) {
+      output_ += ',';
+    }
+    if (!space_.empty()) {
+      output_ += '\n';
+      output_ += indent_;
+    }
+    WriteKey(key);
+    output_ += ':';
+    if (!space_.empty()) {
+      output_ += ' ';
+    }
+    if (!WriteValue(value)) {
+      return false;
+    }
+    is_empty = false;
+  }
+
+  indent_.resize(start_indent_size);
+  if (!space_.empty() && !is_empty) {
+    output_ += '\n';
+    output_ += indent_;
+  }
+  output_ += '}';
+  depth_--;
+  return true;
+}
+
+bool Serializer::GetKeys(Local<Object> object, Local<Array>* keys) {
+#if NODE_MODULE_VERSION >= 64
+  return object
+      ->GetOwnPropertyNames(
+          context_,
+          static_cast<v8::PropertyFilter>(v8::ONLY_ENUMERABLE |
+                                          v8::SKIP_SYMBOLS),
+          v8::KeyConversionMode::kConvertToString)
+      .ToLocal(keys);
+#else
+  Local<Array> names;
+  if (!object->GetOwnPropertyNames(context_).ToLocal(&names)) {
+    return false;
+  }
+  // Older versions of V8 return indices as numbers.
+  const uint32_t length = names->Length();
+  for (uint32_t i = 0; i < length; i++) {
+    Local<Value> name;
+    Local<String> key;
+    if (!names->Get(context_, i).ToLocal(&name) ||
+        !name->ToString(context_).ToLocal(&key) ||
+        names->Set(context_, i, key).IsNothing()) {
+      return false;
+    }
+  }
+  *keys = names;
+  return true;
+#endif
+}
+
+bool Serializer::GetMethod(Local<Object> object, Local<Value>* method) {
+  // Most objects have neither of the properties, which is found out by
+  // looking them up without getting their values. Proxies and interceptors
+  // may make up the properties, so they are asked the usual way.
+  if (!object->IsProxy() && !object->HasNamedLookupInterceptor() &&
+      object->GetRealNamedPropertyAttributes(context_, to_mdsf_).IsNothing() &&
+      object->GetRealNamedPropertyAttributes(context_, to_json_).IsNothing()) {
+    *method = v8::Undefined(isolate_);
+    return true;
+  }
+
+  if (!object->Get(context_, to_mdsf_).ToLocal(method)) {
+    return false;
+  }
+  if (!(*method)->IsFunction()) {
+    if (!object->Get(context_, to_json_).ToLocal(method)) {
+      return false;
+    }
+    if ((*method)->IsFunction() && IsBuffer(object)) {
+      *method = v8::Undefined(isolate_);
+    }
+  }
+  return true;
+}
+
+bool Serializer::EnterContainer() {
+  if (depth_ == kMaxDepth) {
+    Isolate* isolate = isolate_;
+    THROW_EXCEPTION(RangeError, "Maximum nesting depth exceeded");
+    return false;
+  }
+  depth_++;
+  return true;
+}
+
+void Serializer::WriteNumber(double value) {
+  // Integers are printed without an exponent up to 1e21, but only the ones
+  // that are exactly representable are simple enough to be printed here.
+  if (value == std::floor(value) && std::fabs(value) < kMaxSafeInteger) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    const int64_t integer = static_cast<int64_t>(value);
+    char* begin = FormatUnsigned(integer < 0 ? -integer : integer, end);
+    if (integer < 0) {
+      *--begin = '-';
+    }
+    output_.append(begin, end - begin);
+    return;
+  }
+
+  Local<String> str;
+  if (Number::New(isolate_, value)->ToString(context_).ToLocal(&str)) {
+    ReadString(str);
+    WriteAscii(one_byte_chars_.data(), one_byte_chars_.size());
+  }
+}
+
+bool Serializer::WriteNumber(Local<Value> number) {
+  Local<Number> value;
+  if (!number->ToNumber(context_).ToLocal(&value)) {
+    return false;
+  }
+  WriteNumber(value->Value());
+  return true;
+}
+
+void Serializer::WriteString(Local<String> str) {
+  if (ReadString(str)) {
+    WriteEscaped(one_byte_chars_.data(), one_byte_chars_.size());
+  } else {
+    WriteEscaped(two_byte_chars_.data(), two_byte_chars_.size());
+  }
+}
+
+void Serializer::WriteKey(Local<String> key) {
+  KeyCache& cache = data_->serialized_key_cache;
+  const char* cached_text;
+  size_t cached_length;
+  if (cache.Find(key, &cached_text, &cached_length)) {
+    output_.append(cached_text, cached_length);
+    return;
+  }
+
+  // Keys with non-ASCII characters are not cached, so that cache hits never
+  // make the output non-ASCII.
+  const bool was_ascii = is_ascii_;
+  is_ascii_ = true;
+  const size_t start = output_.size();
+  if (ReadString(key)) {
+    if (IsPlainKey(one_byte_chars_.data(), one_byte_chars_.size())) {
+      WriteAscii(one_byte_chars_.data(), one_byte_chars_.size());
+    } else {
+      WriteEscaped(one_byte_chars_.data(), one_byte_chars_.size());
+    }
+  } else {
+    if (IsPlainKey(two_byte_chars_.data(), two_byte_chars_.size())) {
+      WriteAscii(two_byte_chars_.data(), two_byte_chars_.size());
+    } else {
+      WriteEscaped(two_byte_chars_.data(), two_byte_chars_.size());
+    }
+  }
+  if (is_ascii_) {
+    cache.Add(isolate_, key, output_.data() + start, output_.size() - start);
+  }
+  is_ascii_ = is_ascii_ && was_ascii;
+}
+
+void Serializer::WriteBuffer(Local<Value> buffer) {
+  const uint8_t* data =
+      reinterpret_cast<const uint8_t*>(node::Buffer::Data(buffer));
+  const size_t length = node::Buffer::Length(buffer);
+
+  output_.reserve(output_.size() + (length + 2) / 3 * 4 + 2);
+  output_ += '\'';
+  size_t i = 0;
+  for (; i + 3 <= length; i += 3) {
+    const uint32_t bits = data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+    output_ += kBase64Digits[bits >> 18];
+    output_ += kBase64Digits[(bits >> 12) & 0x3F];
+    output_ += kBase64Digits[(bits >> 6) & 0x3F];
+    output_ += kBase64Digits[bits & 0x3F];
+  }
+  if (i + 1 == length) {
+    const uint32_t bits = data[i] << 16;
+    output_ += kBase64Digits[bits >> 18];
+    output_ += kBase64Digits[(bits >> 12) & 0x3F];
+    output_ += "==";
+  } else if (i + 2 == length) {
+    const uint32_t bits = data[i] << 16 | data[i + 1] << 8;
+    output_ += kBase64Digits[bits >> 18];
+    output_ += kBase64Digits[(bits >> 12) & 0x3F];
+    output_ += kBase64Digits[(bits >> 6) & 0x3F];
+    output_ += '=';
+  }
+  output_ += '\'';
+}
+
+template <typename Char>
+void Serializer::WriteEscaped(const Char* chars, size_t length) {
+  // Escape sequences, encoded non-ASCII characters and the short runs of
+  // other characters are gathered in a batch, which is appended to the
+  // output once it fills up, so that the output only grows by what is
+  // actually written. It takes at least as many bytes as there are
+  // characters.
+  output_.reserve(output_.size() + length + 2);
+  char batch[kEscapeBatchSize];
+  char* const batch_end = batch + kEscapeBatchSize;
+  char* out = batch;
+  *out++ = '\'';
+
+  size_t i = 0;
+  while (i < length) {
+    const size_t run_length =
+        FindCharacterToEscape(chars + i, chars + length);
+    if (run_length > static_cast<size_t>(batch_end - out)) {
+      output_.append(batch, out - batch);
+      out = batch;
+    }
+    if (run_length > kEscapeBatchSize) {
+      WriteAscii(chars + i, run_length);
+    } else {
+      CopyAscii(chars + i, run_length, out);
+      out += run_length;
+    }
+    i += run_length;
+    if (i == length) {
+      break;
+    }
+
+    // Non-ASCII characters tend to come in runs, which are encoded without
+    // getting back to the search.
+    do {
+      if (static_cast<size_t>(batch_end - out) < kMaxEscapedCharacterSize) {
+        output_.append(batch, out - batch);
+        out = batch;
+      }
+      if (chars[i] >= 0x80) {
+        is_ascii_ = false;
+      }
+      out = EscapeCharacter(chars, length, &i, out);
+    } while (i < length && chars[i] >= 0x80);
+  }
+
+  if (out == batch_end) {
+    output_.append(batch, out - batch);
+    out = batch;
+  }
+  *out++ = '\'';
+  output_.append(batch, out - batch);
+}
+
+void Serializer::WriteAscii(const uint8_t* chars, size_t length) {
+  output_.append(reinterpret_cast<const char*>(chars), length);
+}
+
+void Serializer::WriteAscii(const uint16_t* chars, size_t length) {
+  const size_t start = output_.size();
+  output_.resize(start + length);
+  CopyAscii(chars, length, output_.data() + start);
+}
+
+bool Serializer::ReadString(Local<String> str) {
+  const int length = str->Length();
+  if (str->IsOneByte()) {
+    one_byte_chars_.resize(length);
+    str->WriteOneByte(
+#if NODE_MODULE_VERSION >= 67
+        isolate_,
+#endif
+        one_byte_chars_.data(), 0, length, String::NO_NULL_TERMINATION);
+    return true;
+  }
+  two_byte_chars_.resize(length);
+  str->Write(
+#if NODE_MODULE_VERSION >= 67
+      isolate_,
+#endif
+      two_byte_chars_.data(), 0, length, String::NO_NULL_TERMINATION);
+  return false;
+}
+
+Local<String> Serializer::GetKey(Local<String> key, uint32_t index) {
+  if (!key.IsEmpty()) {
+    return key;
+  }
+  char digits[10];
+  char* end = digits + sizeof(digits);
+  char* begin = FormatUnsigned(index, end);
+  return NewFromOneByteOrEmpty(isolate_, begin, NewStringType::kNormal,
+                               static_cast<int>(end - begin));
+}
+
+bool Serializer::IsReplacerKey(Local<String> key) {
+  for (const auto& replacer_key : replacer_keys_) {
+    if (key->StrictEquals(replacer_key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Tells Node.js buffers from other Uint8Arrays the way Buffer.isBuffer()
+// does, by looking for Buffer.prototype in the prototype chain.
+bool Serializer::IsBuffer(Local<Value> value) {
+  if (!value->IsUint8Array()) {
+    return false;
+  }
+
+  if (data_->buffer_prototype.IsEmpty()) {
+    Local<Object> buffer;
+    if (!node::Buffer::New(isolate_, 0).ToLocal(&buffer)) {
+      return false;
+    }
+    data_->buffer_prototype.Reset(isolate_,
+                                  buffer->GetPrototype().As<Object>());
+  }
+
+  Local<Value> prototype = value.As<Object>()->GetPrototype();
+  while (prototype->IsObject()) {
+    if (data_->buffer_prototype == prototype) {
+      return true;
+    }
+    prototype = prototype.As<Object>()->GetPrototype();
+  }
+  return false;
+}
+
+// Creates a string of the `size` bytes of valid UTF-8 at `data`, which are
+// decoded here since V8 validates them as well and decodes them a lot
+// slower. Returns an empty handle if the string would be too long.
+MaybeLocal<String> NewFromValidUtf8(Isolate*    isolate,
+                                    const char* data,
+                                    size_t      size) {
+  std::unique_ptr<uint16_t[]> chars(new uint16_t[size]);
+  bool is_one_byte;
+  const size_t length =
+      Utf8ToUtf16(data, data + size, chars.get(), &is_one_byte);
+  if (length > static_cast<size_t>(String::kMaxLength)) {
+    return MaybeLocal<String>();
+  }
+  if (!is_one_byte) {
+    return String::NewFromTwoByte(isolate, chars.get(), NewStringType::kNormal,
+                                  static_cast<int>(length));
+  }
+  uint8_t* narrow_chars = reinterpret_cast<uint8_t*>(chars.get());
+  NarrowAscii(chars.get(), chars.get() + length,
+              reinterpret_cast<char*>(narrow_chars));
+  return String::NewFromOneByte(isolate, narrow_chars, NewStringType::kNormal,
+                                static_cast<int>(length));
+}
+
+}  // namespace
+
+MaybeLocal<String> Stringify(Isolate*     isolate,
+                             Local<Value> value,
+                             Local<Value> replacer,
+                             Local<Value> space) {
+  Serializer serializer(isolate);
+  if (!serializer.SetSpace(space) || !serializer.SetReplacer(replacer) ||
+      !serializer.Serialize(value)) {
+    return MaybeLocal<String>();
+  }
+
+  const Output& output = *serializer.output();
+  MaybeLocal<String> result;
+  if (output.size() <= static_cast<size_t>(String::kMaxLength)) {
+    const int length = static_cast<int>(output.size());
+    result = serializer.is_ascii() ?
+                 String::NewFromOneByte(
+                     isolate,
+                     reinterpret_cast<const uint8_t*>(output.data()),
+                     NewStringType::kNormal, length) :
+                 NewFromValidUtf8(isolate, output.data(), output.size());
+  }
+  if (result.IsEmpty()) {
+    THROW_EXCEPTION(RangeError, "Invalid string length");
+  }
+  return result;
+}
+
+MaybeLocal<Object> StringifyToBuffer(Isolate*          isolate,
+                                     Local<Value>      value,
+                                     Local<Uint8Array> target,
+                                     size_t            offset) {
+  Serializer serializer(isolate);
+  Output* output = serializer.output();
+  if (!target.IsEmpty()) {
+    output->Lend(node::Buffer::Data(target.As<Object>()) + offset,
+                 target->ByteLength() - offset);
+  }
+  if (!serializer.Serialize(value)) {
+    return MaybeLocal<Object>();
+  }
+
+  const size_t size = output->size();
+  Local<Object> result;
+  if (output->is_lent()) {
+    if (!node::Buffer::New(isolate, target->Buffer(),
+                           target->ByteOffset() + offset, size)
+             .ToLocal(&result)) {
+      return MaybeLocal<Object>();
+    }
+    return result;
+  }
+  if (size == 0) {
+    return node::Buffer::New(isolate, 0);
+  }
+  // The new Buffer takes over the memory of the output without copying it.
+  return node::Buffer::New(isolate, output->Release(), size);
+}
+
+Maybe<size_t> EstimateSize(Isolate* isolate, Local<Value> value) {
+  Serializer serializer(isolate);
+  size_t size = 0;
+  if (!serializer.EstimateSize(value, &size)) {
+    return Nothing<size_t>();
+  }
+  return Just(size);
+}
+
+}  // namespace serializer
+
+}  // namespace mdsf
@@ -0,0 +1,97 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_SERIALIZER_H_
+#define SRC_SERIALIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <v8.h>
+
+namespace mdsf {
+
+namespace serializer {
+
+// Maximal nesting depth of arrays and objects. Values are serialized
+// recursively, so this keeps deep and circular structures from exhausting the
+// native stack.
+const std::size_t kMaxDepth = 1000;
+
+// A bounded cache of the serialized forms of object keys, looked up by the
+// identity of the internalized strings V8 keeps the keys in, so that the keys
+// shared by many objects are only read and escaped once. The cache is
+// direct-mapped, so a new key simply replaces the one it collides with.
+class KeyCache {
+ public:
+  // Count of entries, a power of two.
+  static const std::size_t kCapacity = 1024;
+
+  // Keys whose serialized form is longer than that are not cached.
+  static const std::size_t kMaxKeyLength = 48;
+
+  KeyCache();
+
+  KeyCache(const KeyCache&) = delete;
+  KeyCache& operator=(const KeyCache&) = delete;
+
+  // Points `text` to the serialized form of `key` and sets `length` to its
+  // size if it is cached. Returns true on a hit.
+  bool Find(v8::Local<v8::String> key,
+            const char**          text,
+            std::size_t*          length) const;
+
+  // Caches `length` bytes at `text` as the serialized form of `key`.
+  void Add(v8::Isolate*          isolate,
+           v8::Local<v8::String> key,
+           const char*           text,
+           std::size_t           length);
+
+ private:
+  struct Entry {
+    std::uint32_t length;
+    char text[kMaxKeyLength];
+    v8::Global<v8::String> key;
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+};
+
+// Serializes `value` into a string the same way as the JavaScript
+// implementation in lib/stringify.js does, calling the `toMDSF()` and
+// `toJSON()` methods of objects and the `replacer`, which is either a function
+// or an array of keys to keep, and indenting nested values by `space`.
+// Returns an empty handle if an exception has been thrown.
+v8::MaybeLocal<v8::String> Stringify(v8::Isolate*         isolate,
+                                     v8::Local<v8::Value> value,
+                                     v8::Local<v8::Value> replacer,
+                                     v8::Local<v8::Value> space);
+
+// Serializes `value` the same way as Stringify() without a replacer and
+// indentation into UTF-8 bytes, which are written straight into the `target`
+// starting at `offset`, and returns a Buffer viewing them. If they don't fit
+// there, or if the `target` is empty, the serialization goes on in memory of
+// its own, which a new Buffer returned takes over, and the bytes already
+// written are left in the `target`. The methods of `value` must not detach
+// the `target`. Returns an empty handle if an exception has been thrown.
+v8::MaybeLocal<v8::Object> StringifyToBuffer(
+    v8::Isolate*              isolate,
+    v8::Local<v8::Value>      value,
+    v8::Local<v8::Uint8Array> target = v8::Local<v8::Uint8Array>(),
+    std::size_t               offset = 0);
+
+// Estimates the size in bytes of the output of StringifyToBuffer() for
+// `value` without serializing it. Methods of objects are not called, so the
+// objects serialized by `toMDSF()` or `toJSON()` are estimated by their own
+// properties. Escape sequences are not taken into account and numbers other
+// than integers are counted as the longest ones. Returns nothing if an
+// exception has been thrown.
+v8::Maybe<std::size_t> EstimateSize(v8::Isolate*         isolate,
+                                    v8::Local<v8::Value> value);
+
+}  // namespace serializer
+
+}  // namespace mdsf
+
+#endif  // SRC_SERIALIZER_H_
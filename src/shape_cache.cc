@@ -0,0 +1,113 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "shape_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <v8.h>
+
+using std::size_t;
+using std::uint32_t;
+
+using v8::Isolate;
+using v8::Local;
+using v8::MaybeLocal;
+using v8::Name;
+using v8::Null;
+using v8::ObjectTemplate;
+using v8::String;
+using v8::Value;
+
+namespace mdsf {
+
+namespace shape_cache {
+
+const size_t ShapeCache::kCapacity;
+const size_t ShapeCache::kMaxProperties;
+
+// Returns the hash of the sequence of keys of the `length` key/value pairs
+// at `properties`.
+static uint32_t Hash(const Local<Value>* properties, size_t length) {
+  uint32_t hash = static_cast<uint32_t>(length);
+  for (size_t i = 0; i < length; i++) {
+    uint32_t key_hash = properties[i * 2].As<Name>()->GetIdentityHash();
+    hash = hash * 31 + key_hash;
+  }
+  return hash;
+}
+
+// Returns true if the keys of the `length` key/value pairs at `properties`
+// are all different, which a template requires.
+static bool HasUniqueKeys(const Local<Value>* properties, size_t length) {
+  for (size_t i = 1; i < length; i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (properties[i * 2] == properties[j * 2]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+ShapeCache::ShapeCache()
+    : entries_(new Entry[kCapacity]), hits_(0), misses_(0) {
+  for (size_t i = 0; i < kCapacity; i++) {
+    entries_[i].hash = 0;
+    entries_[i].length = 0;
+  }
+}
+
+MaybeLocal<ObjectTemplate> ShapeCache::Get(Isolate* isolate,
+                                           const Local<Value>* properties,
+                                           size_t length) {
+  if (length == 0 || length > kMaxProperties) {
+    return MaybeLocal<ObjectTemplate>();
+  }
+
+  const uint32_t hash = Hash(properties, length);
+  Entry& entry = entries_[hash & (kCapacity - 1)];
+
+  bool is_match = entry.hash == hash && entry.length == length;
+  for (size_t i = 0; is_match && i < length; i++) {
+    is_match = Local<String>::New(isolate, entry.keys[i]) == properties[i * 2];
+  }
+
+  if (is_match && !entry.object_template.IsEmpty()) {
+    hits_++;
+    return Local<ObjectTemplate>::New(isolate, entry.object_template);
+  }
+
+  misses_++;
+
+  if (is_match) {
+    // The layout is seen for the second time, the placeholder values of the
+    // template are replaced when the objects are filled.
+    Local<ObjectTemplate> object_template = ObjectTemplate::New(isolate);
+    for (size_t i = 0; i < length; i++) {
+      object_template->Set(properties[i * 2].As<Name>(), Null(isolate));
+    }
+    entry.object_template.Reset(isolate, object_template);
+    return object_template;
+  }
+
+  if (!HasUniqueKeys(properties, length)) {
+    return MaybeLocal<ObjectTemplate>();
+  }
+
+  entry.hash = hash;
+  entry.length = static_cast<uint32_t>(length);
+  for (size_t i = 0; i < length; i++) {
+    entry.keys[i].Reset(isolate, properties[i * 2].As<String>());
+  }
+  for (size_t i = length; i < kMaxProperties; i++) {
+    entry.keys[i].Reset();
+  }
+  entry.object_template.Reset();
+  return MaybeLocal<ObjectTemplate>();
+}
+
+}  // namespace shape_cache
+
+}  // namespace mdsf
@@ -0,0 +1,65 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_SHAPE_CACHE_H_
+#define SRC_SHAPE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <v8.h>
+
+namespace mdsf {
+
+namespace shape_cache {
+
+// A bounded cache of object templates for the layouts of objects, that is,
+// sequences of keys, seen recently. Objects instantiated from a template get
+// all of its properties at once and share a single hidden class instead of
+// walking the transition tree property by property. A template is created
+// when a layout is seen for the second time, so that one-off objects don't
+// pay for it. The cache is direct-mapped, so a new layout simply replaces
+// the one it collides with.
+class ShapeCache {
+ public:
+  // Count of entries, a power of two.
+  static const std::size_t kCapacity = 256;
+
+  // Objects with more properties than that are not cached.
+  static const std::size_t kMaxProperties = 16;
+
+  ShapeCache();
+
+  ShapeCache(const ShapeCache&) = delete;
+  ShapeCache& operator=(const ShapeCache&) = delete;
+
+  // Returns the template of objects whose keys are the first elements of
+  // the `length` key/value pairs at `properties`, or an empty handle if the
+  // layout is not cached yet. The keys must be internalized strings which
+  // are not array indices.
+  v8::MaybeLocal<v8::ObjectTemplate> Get(v8::Isolate* isolate,
+                                         const v8::Local<v8::Value>* properties,
+                                         std::size_t length);
+
+  std::uint64_t hits() const { return hits_; }
+  std::uint64_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    std::uint32_t hash;
+    std::uint32_t length;
+    v8::Global<v8::String> keys[kMaxProperties];
+    v8::Global<v8::ObjectTemplate> object_template;
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+};
+
+}  // namespace shape_cache
+
+}  // namespace mdsf
+
+#endif  // SRC_SHAPE_CACHE_H_
@@ -0,0 +1,701 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "simd_utils.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(MDSF_SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(MDSF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint8_t;
+
+namespace mdsf {
+
+namespace simd_utils {
+
+// Returns the index of the lowest set bit of a non-zero `mask`.
+static inline size_t CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// Returns a mask of the bits of `mask` below its lowest set bit, or of all of
+// the bits if none is set.
+static inline uint32_t BitsBelowLowest(uint32_t mask) {
+  return (mask - 1) & ~mask;
+}
+
+#if defined(MDSF_SIMD_SSE2)
+
+// Returns a mask of bytes of `block` that are ASCII white space characters.
+static inline uint32_t WhiteSpaceMask(__m128i block) {
+  // Characters from '\t' to '\r' are checked with a single unsigned
+  // comparison of `c - '\t'` against 4.
+  const __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+  const __m128i four = _mm_set1_epi8(4);
+  const __m128i is_control_space =
+      _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted);
+  const __m128i is_space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+  return _mm_movemask_epi8(_mm_or_si128(is_control_space, is_space));
+}
+
+static inline uint32_t EqualMask(__m128i block, char a, char b, char c) {
+  const __m128i eq_a = _mm_cmpeq_epi8(block, _mm_set1_epi8(a));
+  const __m128i eq_b = _mm_cmpeq_epi8(block, _mm_set1_epi8(b));
+  const __m128i eq_c = _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+  return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(eq_a, eq_b), eq_c));
+}
+
+static inline uint32_t StringSpecialMask(__m128i block, char quote) {
+  const __m128i eq_quote = _mm_cmpeq_epi8(block, _mm_set1_epi8(quote));
+  const __m128i eq_backslash = _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'));
+  const __m128i eq_lead = _mm_cmpeq_epi8(block, _mm_set1_epi8('\xE2'));
+  const __m128i eq_cr = _mm_cmpeq_epi8(block, _mm_set1_epi8('\x0D'));
+  const __m128i eq_lf = _mm_cmpeq_epi8(block, _mm_set1_epi8('\x0A'));
+  return _mm_movemask_epi8(
+      _mm_or_si128(_mm_or_si128(_mm_or_si128(eq_quote, eq_backslash),
+                                _mm_or_si128(eq_cr, eq_lf)),
+                   eq_lead));
+}
+
+// Returns a mask of bytes of `block` that FindCharacterToEscape() stops at.
+// Control and non-ASCII characters are the ones less than a space when
+// compared as signed bytes.
+static inline uint32_t EscapeMask(__m128i block) {
+  const __m128i is_control_or_non_ascii =
+      _mm_cmplt_epi8(block, _mm_set1_epi8(' '));
+  const __m128i eq_apostrophe = _mm_cmpeq_epi8(block, _mm_set1_epi8('\''));
+  const __m128i eq_quote = _mm_cmpeq_epi8(block, _mm_set1_epi8('"'));
+  const __m128i eq_backslash = _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'));
+  return _mm_movemask_epi8(
+      _mm_or_si128(_mm_or_si128(is_control_or_non_ascii, eq_apostrophe),
+                   _mm_or_si128(eq_quote, eq_backslash)));
+}
+
+// Returns a mask with two bits for every 16-bit character of `block` that
+// FindCharacterToEscape() stops at. Characters from ' ' to 0x7F are checked
+// with a single unsigned saturating subtraction of `c - ' '` and 0x5F.
+static inline uint32_t EscapeMask16(__m128i block) {
+  const __m128i shifted = _mm_sub_epi16(block, _mm_set1_epi16(' '));
+  const __m128i is_printable = _mm_cmpeq_epi16(
+      _mm_subs_epu16(shifted, _mm_set1_epi16(0x7F - ' ')),
+      _mm_setzero_si128());
+  const __m128i eq_apostrophe = _mm_cmpeq_epi16(block, _mm_set1_epi16('\''));
+  const __m128i eq_quote = _mm_cmpeq_epi16(block, _mm_set1_epi16('"'));
+  const __m128i eq_backslash = _mm_cmpeq_epi16(block, _mm_set1_epi16('\\'));
+  const __m128i is_plain = _mm_andnot_si128(
+      _mm_or_si128(_mm_or_si128(eq_apostrophe, eq_quote), eq_backslash),
+      is_printable);
+  return ~_mm_movemask_epi8(is_plain) & 0xFFFF;
+}
+
+#endif  // MDSF_SIMD_SSE2
+
+#if defined(MDSF_SIMD_AVX2)
+
+static inline uint32_t WhiteSpaceMask(__m256i block) {
+  const __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+  const __m256i four = _mm256_set1_epi8(4);
+  const __m256i is_control_space =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, four), shifted);
+  const __m256i is_space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+  return _mm256_movemask_epi8(_mm256_or_si256(is_control_space, is_space));
+}
+
+static inline uint32_t EqualMask(__m256i block, char a, char b, char c) {
+  const __m256i eq_a = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(a));
+  const __m256i eq_b = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(b));
+  const __m256i eq_c = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c));
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_or_si256(eq_a, eq_b), eq_c));
+}
+
+static inline uint32_t StringSpecialMask(__m256i block, char quote) {
+  const __m256i eq_quote = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(quote));
+  const __m256i eq_backslash =
+      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'));
+  const __m256i eq_lead = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\xE2'));
+  const __m256i eq_cr = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\x0D'));
+  const __m256i eq_lf = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\x0A'));
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(eq_quote, eq_backslash),
+                                      _mm256_or_si256(eq_cr, eq_lf)),
+                      eq_lead));
+}
+
+static inline uint32_t EscapeMask(__m256i block) {
+  const __m256i is_control_or_non_ascii =
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(' '), block);
+  const __m256i eq_apostrophe =
+      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\''));
+  const __m256i eq_quote = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'));
+  const __m256i eq_backslash =
+      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'));
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_or_si256(is_control_or_non_ascii, eq_apostrophe),
+                      _mm256_or_si256(eq_quote, eq_backslash)));
+}
+
+static inline uint32_t EscapeMask16(__m256i block) {
+  const __m256i shifted = _mm256_sub_epi16(block, _mm256_set1_epi16(' '));
+  const __m256i is_printable = _mm256_cmpeq_epi16(
+      _mm256_subs_epu16(shifted, _mm256_set1_epi16(0x7F - ' ')),
+      _mm256_setzero_si256());
+  const __m256i eq_apostrophe =
+      _mm256_cmpeq_epi16(block, _mm256_set1_epi16('\''));
+  const __m256i eq_quote = _mm256_cmpeq_epi16(block, _mm256_set1_epi16('"'));
+  const __m256i eq_backslash =
+      _mm256_cmpeq_epi16(block, _mm256_set1_epi16('\\'));
+  const __m256i is_plain = _mm256_andnot_si256(
+      _mm256_or_si256(_mm256_or_si256(eq_apostrophe, eq_quote), eq_backslash),
+      is_printable);
+  return ~_mm256_movemask_epi8(is_plain);
+}
+
+// Error flags of the pairs of adjacent bytes of a UTF-8 string, which are
+// looked up by the high nibble of the first byte, the low nibble of the first
+// byte and the high nibble of the second byte. A pair is invalid if all of
+// the three lookups have a flag in common. The method is described in
+// "Validating UTF-8 In Less Than One Instruction Per Byte" by John Keiser and
+// Daniel Lemire.
+const uint8_t kTooShort = 1 << 0;  // Lead byte not followed by continuation
+const uint8_t kTooLong = 1 << 1;   // Continuation byte after an ASCII one
+const uint8_t kOverlong3 = 1 << 2;
+const uint8_t kTooLarge = 1 << 3;
+const uint8_t kSurrogate = 1 << 4;
+const uint8_t kOverlong2 = 1 << 5;
+const uint8_t kTooLarge1000 = 1 << 6;
+const uint8_t kOverlong4 = 1 << 6;
+const uint8_t kTwoContinuations = 1 << 7;
+const uint8_t kCarry = kTooShort | kTooLong | kTwoContinuations;
+
+// Returns the bytes of the `table` of 16 entries indexed by the low nibbles
+// of the bytes of `nibbles`.
+static inline __m256i LookUpNibbles(__m256i nibbles, __m128i table) {
+  return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(table),
+                             _mm256_and_si256(nibbles, _mm256_set1_epi8(0xF)));
+}
+
+// Returns a vector with non-zero bytes where the bytes of `block` make up
+// invalid UTF-8 sequences, taking the sequences started in the `previous`
+// block into account.
+static inline __m256i Utf8ErrorMask(__m256i block, __m256i previous) {
+  // The last 16 bytes of `previous` followed by the first 16 of `block`,
+  // which the bytes preceding the ones of `block` are taken from.
+  const __m256i joined = _mm256_permute2x128_si256(previous, block, 0x21);
+  const __m256i prev1 = _mm256_alignr_epi8(block, joined, 15);
+  const __m256i prev2 = _mm256_alignr_epi8(block, joined, 14);
+  const __m256i prev3 = _mm256_alignr_epi8(block, joined, 13);
+
+  const __m256i byte_1_high = LookUpNibbles(
+      _mm256_srli_epi16(prev1, 4),
+      _mm_setr_epi8(
+          // 0_______ ________
+          kTooLong, kTooLong, kTooLong, kTooLong,
+          kTooLong, kTooLong, kTooLong, kTooLong,
+          // 10______ ________
+          kTwoContinuations, kTwoContinuations,
+          kTwoContinuations, kTwoContinuations,
+          // 1100____ ________
+          kTooShort | kOverlong2,
+          // 1101____ ________
+          kTooShort,
+          // 1110____ ________
+          kTooShort | kOverlong3 | kSurrogate,
+          // 1111____ ________
+          kTooShort | kTooLarge | kTooLarge1000 | kOverlong4));
+  const __m256i byte_1_low = LookUpNibbles(
+      prev1,
+      _mm_setr_epi8(
+          // ____0000 ________
+          kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+          // ____0001 ________
+          kCarry | kOverlong2,
+          // ____001_ ________
+          kCarry, kCarry,
+          // ____0100 ________
+          kCarry | kTooLarge,
+          // ____0101 ________ and above
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000,
+          // ____1101 ________
+          kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+          kCarry | kTooLarge | kTooLarge1000,
+          kCarry | kTooLarge | kTooLarge1000));
+  const __m256i byte_2_high = LookUpNibbles(
+      _mm256_srli_epi16(block, 4),
+      _mm_setr_epi8(
+          // ________ 0_______
+          kTooShort, kTooShort, kTooShort, kTooShort,
+          kTooShort, kTooShort, kTooShort, kTooShort,
+          // ________ 1000____
+          kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 |
+              kTooLarge1000 | kOverlong4,
+          // ________ 1001____
+          kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 | kTooLarge,
+          // ________ 101_____
+          kTooLong | kOverlong2 | kTwoContinuations | kSurrogate | kTooLarge,
+          kTooLong | kOverlong2 | kTwoContinuations | kSurrogate | kTooLarge,
+          // ________ 11______
+          kTooShort, kTooShort, kTooShort, kTooShort));
+  const __m256i special_cases = _mm256_and_si256(
+      _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+  // Two continuation bytes in a row are only valid as the third and the
+  // fourth bytes of sequences, which are the ones following the lead bytes
+  // of three and four byte sequences by two and three bytes.
+  const __m256i is_third_byte =
+      _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+  const __m256i is_fourth_byte =
+      _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+  const __m256i must_be_continuation = _mm256_and_si256(
+      _mm256_or_si256(is_third_byte, is_fourth_byte),
+      _mm256_set1_epi8(0x80));
+  return _mm256_xor_si256(must_be_continuation, special_cases);
+}
+
+#endif  // MDSF_SIMD_AVX2
+
+#if !defined(MDSF_SIMD_AVX2)
+
+// States of the DFA validating UTF-8 without AVX2. Each of them is the
+// offset of the bits of its next state in the entries of kUtf8Transitions.
+// The DFA stays in the error state once it gets there.
+const unsigned kUtf8Error = 0;
+const unsigned kUtf8Accept = 6;
+const unsigned kUtf8Continuation1 = 12;  // One continuation byte left
+const unsigned kUtf8Continuation2 = 18;  // Two continuation bytes left
+const unsigned kUtf8Continuation3 = 24;  // Three continuation bytes left
+const unsigned kUtf8AfterE0 = 30;        // Two left, the next one >= 0xA0
+const unsigned kUtf8AfterED = 36;        // Two left, the next one < 0xA0
+const unsigned kUtf8AfterF0 = 42;        // Three left, the next one >= 0x90
+const unsigned kUtf8AfterF4 = 48;        // Three left, the next one < 0x90
+
+// Returns the bits of the transition from the state `from` to `to`.
+static constexpr uint64_t Utf8Transition(unsigned from, unsigned to) {
+  return static_cast<uint64_t>(to) << from;
+}
+
+// Returns the entry of the transition table for the byte `c`, which holds
+// the next states for all of the states.
+static constexpr uint64_t GetUtf8TransitionsOf(unsigned c) {
+  return c < 0x80 ? Utf8Transition(kUtf8Accept, kUtf8Accept) :
+         c < 0xC0 ?
+             Utf8Transition(kUtf8Continuation1, kUtf8Accept) |
+                 Utf8Transition(kUtf8Continuation2, kUtf8Continuation1) |
+                 Utf8Transition(kUtf8Continuation3, kUtf8Continuation2) |
+                 (c >= 0xA0 ?
+                      Utf8Transition(kUtf8AfterE0, kUtf8Continuation1) :
+                      Utf8Transition(kUtf8AfterED, kUtf8Continuation1)) |
+                 (c >= 0x90 ?
+                      Utf8Transition(kUtf8AfterF0, kUtf8Continuation2) :
+                      Utf8Transition(kUtf8AfterF4, kUtf8Continuation2)) :
+         c < 0xC2 ? 0 :
+         c < 0xE0 ? Utf8Transition(kUtf8Accept, kUtf8Continuation1) :
+         c == 0xE0 ? Utf8Transition(kUtf8Accept, kUtf8AfterE0) :
+         c == 0xED ? Utf8Transition(kUtf8Accept, kUtf8AfterED) :
+         c < 0xF0 ? Utf8Transition(kUtf8Accept, kUtf8Continuation2) :
+         c == 0xF0 ? Utf8Transition(kUtf8Accept, kUtf8AfterF0) :
+         c < 0xF4 ? Utf8Transition(kUtf8Accept, kUtf8Continuation3) :
+         c == 0xF4 ? Utf8Transition(kUtf8Accept, kUtf8AfterF4) :
+         0;
+}
+
+#define MDSF_UTF8_TRANSITIONS_4(c)                                   \
+  GetUtf8TransitionsOf(c), GetUtf8TransitionsOf(c + 1),              \
+      GetUtf8TransitionsOf(c + 2), GetUtf8TransitionsOf(c + 3)
+#define MDSF_UTF8_TRANSITIONS_16(c)                                  \
+  MDSF_UTF8_TRANSITIONS_4(c), MDSF_UTF8_TRANSITIONS_4(c + 4),        \
+      MDSF_UTF8_TRANSITIONS_4(c + 8), MDSF_UTF8_TRANSITIONS_4(c + 12)
+#define MDSF_UTF8_TRANSITIONS_64(c)                                  \
+  MDSF_UTF8_TRANSITIONS_16(c), MDSF_UTF8_TRANSITIONS_16(c + 16),     \
+      MDSF_UTF8_TRANSITIONS_16(c + 32), MDSF_UTF8_TRANSITIONS_16(c + 48)
+
+// The next states of the DFA for each byte, so that a step takes a single
+// lookup and a shift, which doesn't depend on the byte classified.
+constexpr uint64_t kUtf8Transitions[256] = {
+  MDSF_UTF8_TRANSITIONS_64(0u), MDSF_UTF8_TRANSITIONS_64(64u),
+  MDSF_UTF8_TRANSITIONS_64(128u), MDSF_UTF8_TRANSITIONS_64(192u)
+};
+
+#undef MDSF_UTF8_TRANSITIONS_64
+#undef MDSF_UTF8_TRANSITIONS_16
+#undef MDSF_UTF8_TRANSITIONS_4
+
+static_assert((kUtf8Transitions[0xED] >> kUtf8Accept & 0x3F) == kUtf8AfterED,
+              "Invalid UTF-8 transition table");
+static_assert((kUtf8Transitions[0xA0] >> kUtf8AfterED & 0x3F) == kUtf8Error,
+              "Invalid UTF-8 transition table");
+
+#endif  // !MDSF_SIMD_AVX2
+
+// Returns true if `c` is a character FindCharacterToEscape() stops at.
+static inline bool IsCharacterToEscape(uint32_t c) {
+  return c < ' ' || c >= 0x80 || c == '\'' || c == '"' || c == '\\';
+}
+
+size_t SkipAsciiWhiteSpace(const char* begin, const char* end) {
+  const char* pos = begin;
+
+  // Most tokens are separated by a single space or none at all, so don't
+  // bother loading a whole block unless there is a run to skip.
+  if (pos + 1 >= end || !IsAsciiWhiteSpace(pos[1])) {
+    return pos < end && IsAsciiWhiteSpace(*pos) ? 1 : 0;
+  }
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = ~WhiteSpaceMask(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = ~WhiteSpaceMask(block) & 0xFFFF;
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  while (pos < end && IsAsciiWhiteSpace(*pos)) {
+    pos++;
+  }
+  return pos - begin;
+}
+
+size_t FindFirstOf(const char* begin,
+                   const char* end,
+                   char a,
+                   char b,
+                   char c) {
+  const char* pos = begin;
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = EqualMask(block, a, b, c);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = EqualMask(block, a, b, c);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  while (pos < end && *pos != a && *pos != b && *pos != c) {
+    pos++;
+  }
+  return pos - begin;
+}
+
+size_t FindStringSpecialCharacter(const char* begin,
+                                  const char* end,
+                                  char quote,
+                                  bool* is_ascii) {
+  const char* pos = begin;
+  uint32_t non_ascii = 0;
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = StringSpecialMask(block, quote);
+    if (mask != 0) {
+      non_ascii |= _mm256_movemask_epi8(block) & BitsBelowLowest(mask);
+      if (non_ascii != 0) {
+        *is_ascii = false;
+      }
+      return pos - begin + CountTrailingZeros(mask);
+    }
+    non_ascii |= _mm256_movemask_epi8(block);
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = StringSpecialMask(block, quote);
+    if (mask != 0) {
+      non_ascii |= _mm_movemask_epi8(block) & BitsBelowLowest(mask);
+      if (non_ascii != 0) {
+        *is_ascii = false;
+      }
+      return pos - begin + CountTrailingZeros(mask);
+    }
+    non_ascii |= _mm_movemask_epi8(block);
+  }
+#endif
+
+  for (; pos < end; pos++) {
+    const char c = *pos;
+    if (c == quote || c == '\\' || c == '\x0D' || c == '\x0A' ||
+        c == '\xE2') {
+      break;
+    }
+    non_ascii |= static_cast<unsigned char>(c) & 0x80;
+  }
+  if (non_ascii != 0) {
+    *is_ascii = false;
+  }
+  return pos - begin;
+}
+
+size_t FindNonAscii(const char* begin, const char* end) {
+  const char* pos = begin;
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = _mm256_movemask_epi8(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = _mm_movemask_epi8(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  while (pos < end && static_cast<unsigned char>(*pos) < 0x80) {
+    pos++;
+  }
+  return pos - begin;
+}
+
+size_t FindCharacterToEscape(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* pos = begin;
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = EscapeMask(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = EscapeMask(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask);
+    }
+  }
+#endif
+
+  while (pos < end && !IsCharacterToEscape(*pos)) {
+    pos++;
+  }
+  return pos - begin;
+}
+
+size_t FindCharacterToEscape(const uint16_t* begin, const uint16_t* end) {
+  const uint16_t* pos = begin;
+
+#if defined(MDSF_SIMD_AVX2)
+  for (; end - pos >= 16; pos += 16) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const uint32_t mask = EscapeMask16(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask) / 2;
+    }
+  }
+#endif
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 8; pos += 8) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const uint32_t mask = EscapeMask16(block);
+    if (mask != 0) {
+      return pos - begin + CountTrailingZeros(mask) / 2;
+    }
+  }
+#endif
+
+  while (pos < end && !IsCharacterToEscape(*pos)) {
+    pos++;
+  }
+  return pos - begin;
+}
+
+void NarrowAscii(const uint16_t* begin, const uint16_t* end, char* out) {
+  const uint16_t* pos = begin;
+
+#if defined(MDSF_SIMD_SSE2)
+  for (; end - pos >= 16; pos += 16, out += 16) {
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const __m128i high =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_packus_epi16(low, high));
+  }
+#endif
+
+  while (pos < end) {
+    *out++ = static_cast<char>(*pos++);
+  }
+}
+
+// Returns the size of the valid UTF-8 sequence of a non-ASCII character
+// starting at `pos`, or 0 if the sequence is invalid or truncated by `end`.
+static inline size_t GetUtf8SequenceSize(const uint8_t* pos,
+                                         const uint8_t* end) {
+  const uint8_t lead = *pos;
+  size_t size;
+  // The range of the second byte excludes overlong forms, surrogates and
+  // code points above U+10FFFF.
+  uint8_t min = 0x80;
+  uint8_t max = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    size = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    size = 3;
+    min = lead == 0xE0 ? 0xA0 : min;
+    max = lead == 0xED ? 0x9F : max;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    size = 4;
+    min = lead == 0xF0 ? 0x90 : min;
+    max = lead == 0xF4 ? 0x8F : max;
+  } else {
+    return 0;
+  }
+  if (static_cast<size_t>(end - pos) < size || pos[1] < min || pos[1] > max) {
+    return 0;
+  }
+  for (size_t i = 2; i < size; i++) {
+    if ((pos[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return size;
+}
+
+size_t ValidateUtf8(const char* begin, const char* end) {
+  const uint8_t* first = reinterpret_cast<const uint8_t*>(begin);
+  const uint8_t* last = reinterpret_cast<const uint8_t*>(end);
+  const uint8_t* pos = first;
+
+#if defined(MDSF_SIMD_AVX2)
+  __m256i previous = _mm256_setzero_si256();
+  for (; last - pos >= 32; pos += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    if ((_mm256_movemask_epi8(block) | _mm256_movemask_epi8(previous)) != 0) {
+      const __m256i errors = Utf8ErrorMask(block, previous);
+      if (!_mm256_testz_si256(errors, errors)) {
+        break;
+      }
+    }
+    previous = block;
+  }
+#else
+  // Non-ASCII characters are checked 8 bytes at a time by the DFA and the
+  // runs of ASCII ones between them are skipped. The DFA doesn't tell where
+  // an invalid sequence starts, so the block it is found in is checked again
+  // below.
+  unsigned state = kUtf8Accept;
+  while (last - pos >= 8) {
+    if (state == kUtf8Accept && *pos < 0x80) {
+      pos += FindNonAscii(reinterpret_cast<const char*>(pos),
+                          reinterpret_cast<const char*>(last));
+      continue;
+    }
+    unsigned next_state = state;
+    for (int i = 0; i < 8; i++) {
+      next_state = kUtf8Transitions[pos[i]] >> next_state & 0x3F;
+    }
+    if (next_state == kUtf8Error) {
+      break;
+    }
+    state = next_state;
+    pos += 8;
+  }
+#endif
+
+  // The bytes before `pos` are valid UTF-8 but for a sequence the last three
+  // of them may start, so the rest is checked from the character the first
+  // of these bytes belongs to, which is the one after the continuation bytes
+  // of the previous characters.
+  if (pos - first > 3) {
+    pos -= 3;
+    for (int i = 0; i < 3 && (*pos & 0xC0) == 0x80; i++) {
+      pos++;
+    }
+  } else {
+    pos = first;
+  }
+
+  while (true) {
+    pos += FindNonAscii(reinterpret_cast<const char*>(pos),
+                        reinterpret_cast<const char*>(last));
+    if (pos == last) {
+      return pos - first;
+    }
+    const size_t size = GetUtf8SequenceSize(pos, last);
+    if (size == 0) {
+      return pos - first;
+    }
+    pos += size;
+  }
+}
+
+}  // namespace simd_utils
+
+}  // namespace mdsf
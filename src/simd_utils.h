@@ -0,0 +1,87 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_SIMD_UTILS_H_
+#define SRC_SIMD_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#define MDSF_SIMD_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MDSF_SIMD_SSE2
+#endif
+
+namespace mdsf {
+
+namespace simd_utils {
+
+// Returns true if `c` is an ASCII white space or line terminator character,
+// i.e. one of '\t', '\n', '\v', '\f', '\r' or ' '.
+inline bool IsAsciiWhiteSpace(char c) {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+// Returns count of leading ASCII white space and line terminator characters
+// in the range from `begin` to `end`. Checks 16 (SSE2) or 32 (AVX2) bytes at
+// a time.
+std::size_t SkipAsciiWhiteSpace(const char* begin, const char* end);
+
+// Returns the offset of the first byte in the range from `begin` to `end`
+// that is equal to either `a`, `b` or `c`, or `end - begin` if there is no
+// such byte.
+std::size_t FindFirstOf(const char* begin,
+                        const char* end,
+                        char a,
+                        char b,
+                        char c);
+
+// Returns the offset of the first byte in the range from `begin` to `end`
+// that may require special handling inside of a string literal enclosed in
+// `quote` characters: the closing quote, a backslash, CR, LF or the 0xE2 lead
+// byte of U+2028 and U+2029. Returns `end - begin` if there is no such byte.
+// `is_ascii` receives false if any of the bytes before the returned offset
+// is not an ASCII character and is left intact otherwise.
+std::size_t FindStringSpecialCharacter(const char* begin,
+                                       const char* end,
+                                       char quote,
+                                       bool* is_ascii);
+
+// Returns the offset of the first byte in the range from `begin` to `end`
+// that is not an ASCII character, or `end - begin` if there is no such byte.
+std::size_t FindNonAscii(const char* begin, const char* end);
+
+// Returns the offset of the first character in the range from `begin` to
+// `end` that can't be copied into a serialized string literal as is: a quote,
+// a backslash, a control character or a non-ASCII character, which has to be
+// encoded. Returns `end - begin` if there is no such character. Checks 16
+// (SSE2) or 32 (AVX2) bytes at a time.
+std::size_t FindCharacterToEscape(const std::uint8_t* begin,
+                                  const std::uint8_t* end);
+std::size_t FindCharacterToEscape(const std::uint16_t* begin,
+                                  const std::uint16_t* end);
+
+// Copies the ASCII characters from `begin` to `end` into `out`, one byte per
+// character. Characters below 0x100 are copied the same way, and `out` may
+// point to `begin` to narrow the characters in place.
+void NarrowAscii(const std::uint16_t* begin,
+                 const std::uint16_t* end,
+                 char* out);
+
+// Returns the offset of the first byte of the first invalid UTF-8 sequence
+// in the range from `begin` to `end`, or `end - begin` if the range is valid
+// UTF-8. Overlong forms, surrogates, code points above U+10FFFF and sequences
+// truncated by `end` are invalid. Checks 32 bytes at a time with lookup
+// tables (AVX2), or else skips 16 ASCII characters at a time (SSE2) and
+// checks the others 8 bytes at a time with a table-driven DFA.
+std::size_t ValidateUtf8(const char* begin, const char* end);
+
+}  // namespace simd_utils
+
+}  // namespace mdsf
+
+#endif  // SRC_SIMD_UTILS_H_
@@ -0,0 +1,181 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "stream_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+
+#include "common.h"
+#include "isolate_data.h"
+#include "message_parser.h"
+#include "tokenizer.h"
+
+using std::memchr;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+using v8::Array;
+using v8::Context;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::MaybeLocal;
+using v8::Object;
+using v8::String;
+using v8::Uint8Array;
+using v8::Value;
+
+using mdsf::isolate_data::ScopedTape;
+using mdsf::message_parser::kMessageTerminator;
+using mdsf::message_parser::ParseJSTPMessage;
+
+namespace mdsf {
+
+namespace stream_parser {
+
+// Pending data larger than that is released rather than kept for the next
+// message once it has been parsed.
+static const size_t kMaxRetainedPendingSize = 1024 * 1024;
+
+void StreamParser::Init(Local<Object> target) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+
+  Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+  Local<String> name = NewFromUtf8OrEmpty(isolate, "StreamParser");
+  tpl->SetClassName(name);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "write", Write);
+
+  Local<Function> constructor;
+  if (tpl->GetFunction(context).ToLocal(&constructor)) {
+    target->Set(context, name, constructor).FromMaybe(false);
+  }
+}
+
+void StreamParser::New(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args.IsConstructCall()) {
+    THROW_EXCEPTION(TypeError, "StreamParser must be called with new");
+    return;
+  }
+
+  StreamParser* parser = new StreamParser();
+  parser->Wrap(args.This());
+  args.GetReturnValue().Set(args.This());
+}
+
+void StreamParser::Write(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() != 2) {
+    THROW_EXCEPTION(TypeError, "Wrong number of arguments");
+    return;
+  }
+  if (!args[1]->IsArray()) {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+    return;
+  }
+
+  HandleScope scope(isolate);
+
+  StreamParser* parser = ObjectWrap::Unwrap<StreamParser>(args.Holder());
+  Local<Array> out = args[1].As<Array>();
+
+  if (parser->is_writing_) {
+    THROW_EXCEPTION(Error, "StreamParser is already writing");
+    return;
+  }
+  parser->is_writing_ = true;
+
+  if (args[0]->IsString()) {
+    String::Utf8Value str(
+#if NODE_MODULE_VERSION >= 57
+        isolate,
+#endif
+        args[0]
+    );
+    parser->Write(isolate, *str, str.length(), out);
+  } else if (args[0]->IsUint8Array()) {
+    Local<Uint8Array> buf = args[0].As<Uint8Array>();
+    void* data = buf->Buffer()->GetContents().Data();
+    const char* str = static_cast<const char*>(data) + buf->ByteOffset();
+    parser->Write(isolate, str, buf->ByteLength(), out);
+  } else {
+    THROW_EXCEPTION(TypeError, "Wrong argument type");
+  }
+
+  parser->is_writing_ = false;
+}
+
+bool StreamParser::Write(Isolate* isolate,
+                         const char* data,
+                         size_t length,
+                         Local<Array> out) {
+  auto context = isolate->GetCurrentContext();
+  uint32_t out_index = out->Length();
+  const char* pos = data;
+  const char* end = data + length;
+  ScopedTape tape(isolate_data::Get(isolate));
+
+  while (pos < end) {
+    const char* terminator = static_cast<const char*>(
+        memchr(pos, kMessageTerminator, end - pos));
+    if (!terminator) {
+      break;
+    }
+
+    MaybeLocal<Value> message;
+    if (pending_.empty()) {
+      // The whole message is in the chunk and is followed by the terminator.
+      message = ParseJSTPMessage(isolate, tape.get(), pos, terminator);
+    } else {
+      pending_.insert(pending_.end(), pos, terminator);
+      pending_.push_back(kMessageTerminator);
+      const char* begin = pending_.data();
+      message = ParseJSTPMessage(isolate, tape.get(), begin,
+                                 begin + pending_.size() - 1);
+      ClearPending();
+    }
+    pos = terminator + 1;
+
+    Local<Value> value;
+    if (!message.ToLocal(&value) ||
+        !out->Set(context, out_index++, value).FromMaybe(false)) {
+      ClearPending();
+      return false;
+    }
+  }
+
+  if (pending_.size() + (end - pos) > tokenizer::kMaxInputSize) {
+    ClearPending();
+    THROW_EXCEPTION(RangeError, "Message is too large");
+    return false;
+  }
+  pending_.insert(pending_.end(), pos, end);
+  return true;
+}
+
+void StreamParser::ClearPending() {
+  if (pending_.capacity() > kMaxRetainedPendingSize) {
+    vector<char>().swap(pending_);
+  } else {
+    pending_.clear();
+  }
+}
+
+}  // namespace stream_parser
+
+}  // namespace mdsf
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_STREAM_PARSER_H_
+#define SRC_STREAM_PARSER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <node_object_wrap.h>
+#include <v8.h>
+
+namespace mdsf {
+
+namespace stream_parser {
+
+// A parser of JSTP messages arriving in chunks of arbitrary size, exposed to
+// JavaScript as the StreamParser class. Unlike ParseJSTPMessages(), it keeps
+// the incomplete message at the end of a chunk itself, so that every byte is
+// searched for a terminator once and every message is parsed once, right
+// from the chunk if it isn't split between several of them.
+class StreamParser : public node::ObjectWrap {
+ public:
+  // Adds the StreamParser constructor to the `target` object.
+  static void Init(v8::Local<v8::Object> target);
+
+ private:
+  StreamParser() : is_writing_(false) {}
+
+  // new StreamParser()
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // streamParser.write(data, messages) parses the messages completed by the
+  // string or Uint8Array `data` into the `messages` array.
+  static void Write(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Appends the messages completed by `length` bytes at `data` to `out`.
+  // Returns false if an exception has been thrown, in which case the data
+  // that hasn't been parsed yet is discarded.
+  bool Write(v8::Isolate* isolate,
+             const char* data,
+             std::size_t length,
+             v8::Local<v8::Array> out);
+
+  // Releases the memory of the pending data if it has grown large.
+  void ClearPending();
+
+  // The beginning of the message that hasn't been terminated yet.
+  std::vector<char> pending_;
+
+  // Whether a write is in progress, which JavaScript called from it must not
+  // start another one.
+  bool is_writing_;
+};
+
+}  // namespace stream_parser
+
+}  // namespace mdsf
+
+#endif  // SRC_STREAM_PARSER_H_
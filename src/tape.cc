@@ -0,0 +1,1045 @@
+// Copyright (c) 2016-2017 JSTP project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+// Copyright (c) 2018-2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "tape.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "number_parser.h"
+#include "simd_utils.h"
+#include "tokenizer.h"
+#include "unicode_utils.h"
+
+using std::isxdigit;
+using std::memcmp;
+using std::memcpy;
+using std::size_t;
+using std::strncmp;
+using std::toupper;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+using mdsf::unicode_utils::CodePointToUtf8;
+using mdsf::unicode_utils::IsLineTerminatorSequence;
+using mdsf::unicode_utils::Utf8ToCodePoint;
+using mdsf::unicode_utils::IsIdStartCodePoint;
+using mdsf::unicode_utils::IsIdPartCodePoint;
+using mdsf::simd_utils::FindStringSpecialCharacter;
+using mdsf::tokenizer::GetCharClass;
+using mdsf::tokenizer::GetTokenType;
+using mdsf::tokenizer::IsAsciiDigit;
+using mdsf::tokenizer::StructuralIndex;
+using mdsf::tokenizer::Token;
+using mdsf::tokenizer::TokenType;
+using mdsf::tokenizer::kArrayToken;
+using mdsf::tokenizer::kBoolToken;
+using mdsf::tokenizer::kDigitClass;
+using mdsf::tokenizer::kIdStartClass;
+using mdsf::tokenizer::kInvalidToken;
+using mdsf::tokenizer::kNullToken;
+using mdsf::tokenizer::kNumberToken;
+using mdsf::tokenizer::kObjectToken;
+using mdsf::tokenizer::kStringToken;
+using mdsf::tokenizer::kStructuralClass;
+using mdsf::tokenizer::kUndefinedToken;
+
+namespace mdsf {
+
+namespace tape {
+
+// Parses the type of the serialized JavaScript value at the position `begin`
+// and before `end`. Returns true if it was able to detect the type, false
+// otherwise.
+static bool GetType(const char* begin, const char* end, TokenType* type);
+
+// Returns the first character of the token `position` of the `index`.
+static char GetTokenChar(const StructuralIndex& index, size_t position);
+
+// Returns the offset of the token `position` of the `index` from the
+// beginning of the input, or the size of the input if there is no such token.
+static size_t GetTokenOffset(const StructuralIndex& index, size_t position);
+
+// Fills `error` and returns false so that it can be used in return
+// statements.
+static bool SetError(Error* error,
+                     ErrorType type,
+                     const char* message,
+                     size_t offset = 0);
+
+static void AppendNode(Tape* tape, NodeType type);
+static void AppendNumber(Tape* tape, double number);
+static void AppendString(Tape* tape, const char* str, size_t size,
+                         bool is_ascii);
+
+// The table of functions parsing scalar values indexed with the values of the
+// TokenType enumeration.
+static constexpr bool (*kParseFunctions[])(const char*,
+                                           const char*,
+                                           size_t*,
+                                           Tape*,
+                                           Error*) = {
+  &internal::ParseUndefined,
+  &internal::ParseNull,
+  &internal::ParseBool,
+  &internal::ParseNumber,
+  &internal::ParseString
+};
+
+// Parses a scalar value of the type `type` starting at the token `*position`
+// of the `index` and advances `position` past it. Elided array elements, i.e.
+// commas and closing brackets parsed as undefined values, consume no tokens.
+static bool ParseToken(const StructuralIndex& index,
+                       size_t*                position,
+                       TokenType              type,
+                       Tape*                  tape,
+                       Error*                 error);
+
+bool Parse(const char* begin, const char* end, Tape* tape, Error* error,
+           size_t max_depth, const Schema* schema, bool validate_utf8) {
+  tape->nodes.clear();
+  tape->arena.Reset();
+
+  if (static_cast<size_t>(end - begin) > tokenizer::kMaxInputSize) {
+    return SetError(error, kRangeError, "Input is too large");
+  }
+
+  StructuralIndex& index = tape->index;
+  size_t invalid_offset;
+  if (!tokenizer::Tokenize(begin, end, &index, validate_utf8,
+                           &invalid_offset)) {
+    return SetError(error, kSyntaxError, "Invalid UTF-8 sequence",
+                    invalid_offset);
+  }
+
+  TokenType type;
+
+  if (index.tokens.empty() ||
+      !GetType(begin + index.tokens[0].offset, end, &type)) {
+    return SetError(error, kTypeError, "Invalid type",
+                    GetTokenOffset(index, 0));
+  }
+
+  size_t position = 0;
+  const bool ok =
+      type == kArrayToken || type == kObjectToken ?
+          internal::ParseContainer(index, &position, max_depth, tape, error,
+                                   schema) :
+          ParseToken(index, &position, type, tape, error);
+  if (!ok) {
+    return false;
+  }
+
+  if (position != index.tokens.size()) {
+    return SetError(error, kSyntaxError, "Invalid format",
+                    GetTokenOffset(index, position));
+  }
+
+  return true;
+}
+
+bool ParseMessage(const char* begin, const char* end, Tape* tape,
+                  Error* error, size_t max_depth) {
+  tape->nodes.clear();
+  tape->arena.Reset();
+
+  if (static_cast<size_t>(end - begin) > tokenizer::kMaxInputSize) {
+    return SetError(error, kRangeError, "Message is too large");
+  }
+
+  StructuralIndex& index = tape->index;
+  tokenizer::Tokenize(begin, end, &index);
+
+  if (index.tokens.empty() || GetTokenChar(index, 0) != '{') {
+    return SetError(error, kSyntaxError, "Invalid message type",
+                    GetTokenOffset(index, 0));
+  }
+
+  size_t position = 0;
+  if (!internal::ParseContainer(index, &position, max_depth, tape, error)) {
+    return false;
+  }
+
+  if (position != index.tokens.size()) {
+    return SetError(error, kSyntaxError, "Invalid format",
+                    GetTokenOffset(index, position));
+  }
+
+  return true;
+}
+
+static bool ParseToken(const StructuralIndex& index,
+                       size_t*                position,
+                       TokenType              type,
+                       Tape*                  tape,
+                       Error*                 error) {
+  const Token& token = index.tokens[*position];
+  const char* begin = index.input + token.offset;
+
+  if (type == kUndefinedToken && (*begin == ',' || *begin == ']')) {
+    AppendNode(tape, NodeType::kUndefined);
+    return true;
+  }
+
+  bool ok;
+  size_t size = 0;
+
+  if (type == kStringToken && !token.needs_unescaping) {
+    // The tokenizer has already found out that there is nothing to unescape.
+    AppendString(tape, begin + 1, token.size - 2, token.is_ascii);
+    ok = true;
+  } else {
+    ok = kParseFunctions[type](begin, begin + token.size, &size, tape, error);
+    if (ok && size != token.size) {
+      ok = SetError(error, kSyntaxError, "Unexpected token");
+    }
+  }
+
+  if (!ok) {
+    error->offset = token.offset;
+    return false;
+  }
+  (*position)++;
+  return true;
+}
+
+static char GetTokenChar(const StructuralIndex& index, size_t position) {
+  return index.input[index.tokens[position].offset];
+}
+
+static size_t GetTokenOffset(const StructuralIndex& index, size_t position) {
+  if (position < index.tokens.size()) {
+    return index.tokens[position].offset;
+  }
+  return index.input_end - index.input;
+}
+
+static bool SetError(Error* error,
+                     ErrorType type,
+                     const char* message,
+                     size_t offset) {
+  error->type = type;
+  error->message = message;
+  error->offset = offset;
+  return false;
+}
+
+static void AppendNode(Tape* tape, NodeType type) {
+  Node node;
+  node.type = type;
+  node.is_ascii = false;
+  node.size = 0;
+  node.number = 0;
+  tape->nodes.push_back(node);
+}
+
+static void AppendNumber(Tape* tape, double number) {
+  Node node;
+  node.type = NodeType::kNumber;
+  node.is_ascii = false;
+  node.size = 0;
+  node.number = number;
+  tape->nodes.push_back(node);
+}
+
+static void AppendString(Tape* tape, const char* str, size_t size,
+                         bool is_ascii) {
+  Node node;
+  node.type = NodeType::kString;
+  node.is_ascii = is_ascii;
+  node.size = static_cast<uint32_t>(size);
+  node.string = str;
+  tape->nodes.push_back(node);
+}
+
+static bool GetType(const char* begin, const char* end, TokenType* type) {
+  *type = GetTokenType(*begin);
+  switch (*type) {
+    case kNullToken: {
+      return begin + 4 > end || strncmp(begin, "null", 4) == 0;
+    }
+    case kUndefinedToken: {
+      return *begin != 'u' || begin + 9 > end ||
+             strncmp(begin, "undefined", 9) == 0;
+    }
+    default: {
+      return *type != kInvalidToken;
+    }
+  }
+}
+
+namespace internal {
+
+bool ParseUndefined(const char* begin,
+                    const char* end,
+                    size_t*     size,
+                    Tape*       tape,
+                    Error*      error) {
+  if (*begin == ',' || *begin == ']') {
+    *size = 0;
+  } else if (*begin == 'u') {
+    *size = 9;
+  } else {
+    return SetError(error, kTypeError, "Invalid format of undefined value");
+  }
+  AppendNode(tape, NodeType::kUndefined);
+  return true;
+}
+
+bool ParseNull(const char* begin,
+               const char* end,
+               size_t*     size,
+               Tape*       tape,
+               Error*      error) {
+  *size = 4;
+  AppendNode(tape, NodeType::kNull);
+  return true;
+}
+
+bool ParseBool(const char* begin,
+               const char* end,
+               size_t*     size,
+               Tape*       tape,
+               Error*      error) {
+  if (begin + 4 <= end && strncmp(begin, "true", 4) == 0) {
+    AppendNode(tape, NodeType::kTrue);
+    *size = 4;
+  } else if (begin + 5 <= end && strncmp(begin, "false", 5) == 0) {
+    AppendNode(tape, NodeType::kFalse);
+    *size = 5;
+  } else {
+    return SetError(error, kTypeError, "Invalid format: expected boolean");
+  }
+  return true;
+}
+
+bool ParseNumber(const char* begin,
+                 const char* end,
+                 size_t*     size,
+                 Tape*       tape,
+                 Error*      error) {
+  bool negate_result = false;
+  const char* number_start = begin;
+
+  if (*begin == '+' || *begin == '-') {
+    negate_result = *begin == '-';
+    number_start++;
+  }
+
+  int base = 10;
+
+  if (number_start + 1 < end && *number_start == '0') {
+    const char prefix = number_start[1];
+    if (prefix == 'b' || prefix == 'B') {
+      base = 2;
+    } else if (prefix == 'o' || prefix == 'O') {
+      base = 8;
+    } else if (prefix == 'x' || prefix == 'X') {
+      base = 16;
+    } else if (IsAsciiDigit(prefix)) {
+      return SetError(error, kSyntaxError,
+          "Legacy octal and non-octal integer literals are not supported");
+    }
+    if (base != 10) {
+      number_start += 2;
+    }
+  }
+
+  double result;
+
+  if (base == 10) {
+    switch (number_parser::ParseDecimalNumber(number_start, end, size,
+                                              &result)) {
+      case number_parser::Status::kOk: {
+        break;
+      }
+      case number_parser::Status::kExpectedNaN: {
+        return SetError(error, kSyntaxError, "Invalid format: expected NaN");
+      }
+      case number_parser::Status::kExpectedInfinity: {
+        return SetError(error, kSyntaxError,
+                        "Invalid format: expected Infinity");
+      }
+    }
+  } else {
+    result = number_parser::ParseIntegerNumber(number_start, end, base, size);
+    if (*size == 0) {
+      return SetError(error, kSyntaxError, "Empty number value");
+    }
+  }
+  *size += number_start - begin;
+  AppendNumber(tape, negate_result ? -result : result);
+  return true;
+}
+
+static bool GetControlChar(const char* str,
+                           size_t*     res_len,
+                           size_t*     size,
+                           char*       write_to,
+                           Error*      error);
+
+bool ParseString(const char* begin,
+                 const char* end,
+                 size_t*     size,
+                 Tape*       tape,
+                 Error*      error) {
+  const char quote = *begin;
+  const char* pos = begin + 1;
+  char* result = nullptr;
+  size_t res_index = 0;
+  size_t out_offset, in_offset;
+  bool is_ascii = true;
+
+  while (true) {
+    // Copy the run of characters that need no special handling in bulk.
+    const char* run_begin = pos;
+    pos += FindStringSpecialCharacter(pos, end, quote, &is_ascii);
+    if (result) {
+      memcpy(result + res_index, run_begin, pos - run_begin);
+    }
+    res_index += pos - run_begin;
+
+    if (pos >= end) {
+      return SetError(error, kSyntaxError, "Error while parsing string");
+    }
+
+    if (*pos == quote) {
+      *size = pos + 1 - begin;
+      break;
+    }
+
+    if (*pos == '\\') {
+      if (!result) {
+        // Escape sequences are never shorter than the characters they stand
+        // for, so the unescaped string fits into the size of the literal.
+        result = tape->arena.Allocate(end - begin);
+        memcpy(result, begin + 1, res_index);
+      }
+      if (IsLineTerminatorSequence(pos + 1, &in_offset)) {
+        pos += in_offset + 1;
+      } else {
+        bool ok = GetControlChar(pos + 1, &out_offset, &in_offset,
+                                 result + res_index, error);
+        if (!ok) {
+          return false;
+        }
+        if (static_cast<unsigned char>(result[res_index]) >= 0x80) {
+          is_ascii = false;
+        }
+        pos += in_offset + 1;
+        res_index += out_offset;
+      }
+    } else if (IsLineTerminatorSequence(pos, &in_offset)) {
+      return SetError(error, kSyntaxError, "Unexpected line end in string");
+    } else {  // 0xE2 lead byte of a character other than U+2028 and U+2029
+      is_ascii = false;
+      if (result) {
+        result[res_index] = *pos;
+      }
+      res_index++;
+      pos++;
+    }
+  }
+
+  if (result) {
+    tape->arena.Shrink(result, end - begin, res_index);
+  }
+  AppendString(tape, result ? result : begin + 1, res_index, is_ascii);
+  return true;
+}
+
+static uint32_t ReadHexNumber(const char* str,
+                              size_t required_len,
+                              bool is_limited,
+                              size_t* len,
+                              bool* ok);
+
+// Parses a Unicode escape sequence after the '\u' part and returns it's
+// code point value. Supports surrogate pairs. Total size of escape
+// sequence (excluding first '\u') is written in `size`.
+static uint32_t ReadUnicodeEscapeSequence(const char* str,
+                                          size_t* size,
+                                          bool* ok,
+                                          Error* error) {
+  uint32_t result = 0xFFFD;
+
+  if (isxdigit(str[0])) {
+    result = ReadHexNumber(str, 4, true, nullptr, ok);
+    if (!*ok) {
+      SetError(error, kSyntaxError, "Invalid Unicode escape sequence");
+      return 0xFFFD;
+    }
+    *size = 4;
+  } else if (str[0] == '{') {
+    size_t hex_size;
+    result = ReadHexNumber(str + 1, 0, false, &hex_size, ok);
+    if (!*ok || result > 0x10FFFF) {
+      *ok = false;
+      SetError(error, kSyntaxError, "Invalid Unicode escape sequence");
+      return 0xFFFD;
+    }
+    *size = hex_size + 2;
+  } else {
+    SetError(error, kSyntaxError, "Expected Unicode escape sequence");
+    *ok = false;
+  }
+
+  // check for surrogate pair
+  if (0xD800 <= result && result <= 0xDBFF) {
+    size_t low_size;
+    if (str[*size] == '\\' && str[*size + 1] == 'u') {
+      uint32_t low_sur = ReadUnicodeEscapeSequence(str + *size + 2,
+                                                   &low_size, ok, error);
+      if (!*ok || !(0xDC00 <= low_sur && low_sur <= 0xDFFF)) {
+        return result;
+      }
+      result = ((result - 0xD800) << 10) + low_sur - 0xDC00 + 0x10000;
+      *size += low_size + 2;
+    }
+  }
+
+  return result;
+}
+
+// Parses a part of a JavaScript string representation after the backslash
+// character (i.e., an escape sequence without \) into an unescaped control
+// character and writes it to `write_to`.
+// Returns true if no error occured, false otherwise.
+static bool GetControlChar(const char* str,
+                           size_t*     res_len,
+                           size_t*     size,
+                           char*       write_to,
+                           Error*      error) {
+  *size = 1;
+  *res_len = 1;
+  bool ok;
+  switch (str[0]) {
+    case 'b': {
+      *write_to = '\b';
+      break;
+    }
+    case 'f': {
+      *write_to = '\f';
+      break;
+    }
+    case 'n': {
+      *write_to = '\n';
+      break;
+    }
+    case 'r': {
+      *write_to = '\r';
+      break;
+    }
+    case 't': {
+      *write_to = '\t';
+      break;
+    }
+    case 'v': {
+      *write_to = '\v';
+      break;
+    }
+
+    case 'x': {
+      *write_to = static_cast<char>(ReadHexNumber(str + 1, 2, true,
+          nullptr, &ok));
+      if (!ok) {
+        return SetError(error, kSyntaxError,
+                        "Invalid hexadecimal escape sequence");
+      }
+      *size = 3;
+      break;
+    }
+
+    case 'u': {
+      uint32_t symb_code = ReadUnicodeEscapeSequence(str + 1, size, &ok,
+                                                     error);
+
+      if (!ok) {
+        return false;
+      }
+      CodePointToUtf8(symb_code, res_len, write_to);
+      *size += 1;
+      break;
+    }
+
+    case '0': {
+      if (IsAsciiDigit(str[1])) {
+        return SetError(error, kSyntaxError,
+            "Decimal digits after \\0 are not allowed in strings");
+      }
+      *write_to = 0;
+      break;
+    }
+
+    default: {
+      if ('0' <= str[0] && str[0] <= '7') {
+        return SetError(error, kSyntaxError,
+            "Octal escape sequences are not allowed in strings");
+      }
+      *write_to = str[0];
+    }
+  }
+
+  return true;
+}
+
+// Parses a hexadecimal number with maximal length of max_len (if is_limited true)
+// into uint32_t. Whether the parsing was successful is determined by the value
+// of `ok`. Resulting size of the value will be outputted in len (if is_limited is
+// false).
+static uint32_t ReadHexNumber(const char* str,
+                              size_t required_len,
+                              bool is_limited,
+                              size_t* len,
+                              bool* ok) {
+  static const int8_t xdigit_table[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, // '0' to '9'
+    -1, -1, -1, -1, -1, -1, -1,   // 0x3A to 0x40
+    10, 11, 12, 13, 14, 15,       // 'A' to 'F'
+    // 'G' to 'Z':
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1,       // 0x5B to 0x60
+    10, 11, 12, 13, 14, 15,       // 'a' to 'f'
+  };
+
+  uint32_t result = 0;
+  uint64_t current_value = 0;
+  size_t current_length = 0;
+  char current_digit;
+
+  *ok = true;
+
+  while (isxdigit(str[current_length])) {
+    current_digit = str[current_length];
+    current_length++;
+    current_value *= 16;
+    current_value += xdigit_table[current_digit - '0'];
+    if (current_value > UINT32_MAX) {
+      *ok = false;
+      return result;
+    }
+    result = current_value;
+    if (is_limited && current_length == required_len) {
+      break;
+    }
+  }
+
+  if (is_limited) {
+    if (current_length < required_len) {
+      *ok = false;
+    }
+  } else {
+    if (current_length == 0) {
+      *ok = false;
+    }
+    *len = current_length;
+  }
+
+  return result;
+}
+
+bool ParseKeyInObject(const char* begin,
+                      const char* end,
+                      size_t*     size,
+                      Tape*       tape,
+                      Error*      error) {
+  *size = end - begin;
+  if (begin[0] == '\'' || begin[0] == '"') {
+    TokenType current_type;
+    bool valid = GetType(begin, end, &current_type);
+    if (valid && current_type == kStringToken) {
+      return ParseString(begin, end, size, tape, error);
+    } else {
+      return SetError(error, kSyntaxError,
+                      "Invalid format in object: key is invalid string");
+    }
+  } else {
+    size_t current_length = 0;
+    size_t cp_size;
+    uint32_t cp;
+    bool ok;
+    char* fallback = nullptr;
+    size_t fallback_length = 0;
+    bool is_escape = false;
+    bool is_ascii = true;
+    while (current_length < *size) {
+      const char c = begin[current_length];
+      if (static_cast<unsigned char>(c) < 0x80 && c != '\\') {
+        // ASCII identifier characters are looked up in the class table.
+        const uint8_t id_classes = current_length == 0 ?
+            kIdStartClass : kIdStartClass | kDigitClass;
+        if (!(GetCharClass(c) & id_classes)) {
+          break;
+        }
+        if (fallback) {
+          fallback[fallback_length++] = c;
+        }
+        current_length++;
+        continue;
+      }
+      if (c == '\\' &&
+          begin[current_length + 1] == 'u') {
+        cp = ReadUnicodeEscapeSequence(begin + current_length + 2,
+                                       &cp_size, &ok, error);
+        if (!ok) {
+          return false;
+        }
+        cp_size += 2;
+        if (!fallback) {
+          // Escape sequences are never shorter than the characters they
+          // stand for.
+          fallback = tape->arena.Allocate(*size);
+          memcpy(fallback, begin, current_length);
+          fallback_length = current_length;
+        }
+        is_escape = true;
+      } else {
+        cp = Utf8ToCodePoint(begin + current_length, &cp_size);
+        is_escape = false;
+      }
+      if (current_length == 0 ? IsIdStartCodePoint(cp) :
+                                IsIdPartCodePoint(cp)) {
+        if (cp >= 0x80) {
+          is_ascii = false;
+        }
+        if (fallback) {
+          if (!is_escape) {
+            memcpy(fallback + fallback_length, begin + current_length, cp_size);
+            fallback_length += cp_size;
+          } else {
+            size_t fallback_cp_size;
+            CodePointToUtf8(cp, &fallback_cp_size, fallback + fallback_length);
+            fallback_length += fallback_cp_size;
+          }
+        }
+        current_length += cp_size;
+      } else {
+        break;
+      }
+    }
+    if (current_length == 0) {
+      return SetError(error, kSyntaxError, "Unexpected identifier");
+    }
+    if (!fallback) {
+      AppendString(tape, begin, current_length, is_ascii);
+    } else {
+      tape->arena.Shrink(fallback, *size, fallback_length);
+      AppendString(tape, fallback, fallback_length, is_ascii);
+    }
+    *size = current_length;
+    return true;
+  }
+}
+
+// Parses an object key starting at the token `*position` of the `index` and
+// advances `position` past it. Numeric keys are appended as numbers.
+static bool ParseKey(const StructuralIndex& index,
+                     size_t*                position,
+                     Tape*                  tape,
+                     Error*                 error) {
+  const Token& token = index.tokens[*position];
+  const char* begin = index.input + token.offset;
+  bool ok;
+  size_t size;
+
+  if (*begin == '\'' || *begin == '"') {
+    if (!token.needs_unescaping) {
+      AppendString(tape, begin + 1, token.size - 2, token.is_ascii);
+      ok = true;
+    } else {
+      ok = ParseKeyInObject(begin, begin + token.size, &size, tape, error);
+    }
+  } else {
+    // Structural characters have no size and thus can't be keys.
+    const char* end = GetCharClass(*begin) & kStructuralClass ?
+                          begin : begin + token.size;
+    if (IsAsciiDigit(*begin)) {
+      ok = ParseNumber(begin, end, &size, tape, error);
+    } else {
+      ok = ParseKeyInObject(begin, end, &size, tape, error);
+    }
+    if (ok && size != token.size) {
+      ok = SetError(error, kSyntaxError, "Unexpected token");
+    }
+  }
+
+  if (!ok) {
+    error->offset = token.offset;
+    return false;
+  }
+  (*position)++;
+  return true;
+}
+
+namespace {
+
+// An array or an object whose contents are being parsed.
+struct Container {
+  // Index of the node of the container in the tape.
+  size_t node;
+  // Index of the node of the key of the property being parsed in an object.
+  size_t key_node;
+  // Count of elements of an array or of properties of an object so far.
+  uint32_t count;
+  bool is_object;
+  // The schema of the container if it is of the same kind, and whether the
+  // keys of an object have matched it so far.
+  const Schema* schema;
+  bool matches_schema;
+};
+
+}  // namespace
+
+// Appends the node of the array or the object starting at the token
+// `*position` of the `index` to the `tape`, pushes it to `containers` and
+// advances `position` past the opening bracket or brace. The container is
+// expected to match the `schema` if there is one. Returns false and fills
+// `error` if there are `max_depth` containers already.
+static bool OpenContainer(const StructuralIndex& index,
+                          size_t*                position,
+                          size_t                 max_depth,
+                          const Schema*          schema,
+                          vector<Container>*     containers,
+                          Tape*                  tape,
+                          Error*                 error) {
+  if (containers->size() >= max_depth) {
+    return SetError(error, kSyntaxError, "Maximum nesting depth exceeded",
+                    GetTokenOffset(index, *position));
+  }
+  Container container;
+  container.node = tape->nodes.size();
+  container.key_node = 0;
+  container.count = 0;
+  container.is_object = GetTokenChar(index, *position) == '{';
+  const bool is_same_kind =
+      schema != nullptr && schema->is_array != container.is_object;
+  container.schema = is_same_kind ? schema : nullptr;
+  container.matches_schema = is_same_kind && container.is_object;
+  containers->push_back(container);
+  AppendNode(tape, container.is_object ? NodeType::kObject :
+                                         NodeType::kArray);
+  tape->nodes.back().schema = nullptr;
+  (*position)++;
+  return true;
+}
+
+// Returns the schema of the value which is being parsed in the `container`,
+// if there is one.
+static const Schema* GetValueSchema(const Container& container) {
+  if (container.schema == nullptr) {
+    return nullptr;
+  }
+  if (!container.is_object) {
+    return container.schema->values[0];
+  }
+  return container.matches_schema ? container.schema->values[container.count] :
+                                    nullptr;
+}
+
+// Appends the key at the token `position` of the `index` to the `tape` if it
+// is the same as the key `number` of the object `schema`, which is found out
+// by comparing the bytes of the key. Returns false otherwise, in which case
+// the key has to be parsed as usual.
+static bool MatchKey(const StructuralIndex& index,
+                     size_t                 position,
+                     const Schema&          schema,
+                     size_t                 number,
+                     Tape*                  tape) {
+  if (number >= schema.keys.size()) {
+    return false;
+  }
+  const Schema::Key& key = schema.keys[number];
+  const Token& token = index.tokens[position];
+  const char* begin = index.input + token.offset;
+  size_t size = token.size;
+
+  if (*begin == '\'' || *begin == '"') {
+    if (token.needs_unescaping) {
+      return false;
+    }
+    begin++;
+    size -= 2;
+  } else if (!key.is_identifier) {
+    return false;
+  }
+
+  if (size != key.text.size() || memcmp(begin, key.text.data(), size) != 0) {
+    return false;
+  }
+  AppendString(tape, begin, size, key.is_ascii);
+  return true;
+}
+
+// Counts the value which has just been appended to the `tape` as the next
+// element or property of the `container`. Properties with undefined values
+// are dropped from the tape instead.
+static void AddValue(Container* container, Tape* tape) {
+  if (container->is_object &&
+      tape->nodes[container->key_node + 1].type == NodeType::kUndefined) {
+    tape->nodes.resize(container->key_node);
+    container->matches_schema = false;
+  } else {
+    container->count++;
+  }
+}
+
+// Sets the size of the innermost of `containers`, which has been closed, and
+// pops it, adding it as a value to the one it is nested in.
+static void CloseContainer(vector<Container>* containers, Tape* tape) {
+  const Container& container = containers->back();
+  Node& node = tape->nodes[container.node];
+  node.size = container.count;
+  if (container.matches_schema &&
+      container.count == container.schema->keys.size()) {
+    node.schema = container.schema;
+  }
+  containers->pop_back();
+  if (!containers->empty()) {
+    AddValue(&containers->back(), tape);
+  }
+}
+
+bool ParseContainer(const StructuralIndex& index,
+                    size_t*                position,
+                    size_t                 max_depth,
+                    Tape*                  tape,
+                    Error*                 error,
+                    const Schema*          schema) {
+  const size_t token_count = index.tokens.size();
+  vector<Container> containers;
+  // Whether an element, a key or a closing bracket or brace is expected at
+  // `*position` rather than a separator.
+  bool expects_value = true;
+
+  if (!OpenContainer(index, position, max_depth, schema, &containers, tape,
+                     error)) {
+    return false;
+  }
+
+  while (*position < token_count) {
+    Container& current = containers.back();
+    const char* begin = index.input + index.tokens[*position].offset;
+
+    if (!expects_value) {
+      const char separator = *begin;
+      const char closing_char = current.is_object ? '}' : ']';
+      if (separator != ',' && separator != closing_char) {
+        return SetError(error, kSyntaxError,
+                        current.is_object ? "Invalid format in object" :
+                            "Invalid format in array: missed comma",
+                        GetTokenOffset(index, *position));
+      }
+      (*position)++;
+      if (separator == closing_char) {
+        CloseContainer(&containers, tape);
+        if (containers.empty()) {
+          return true;
+        }
+      } else {
+        expects_value = true;
+      }
+      continue;
+    }
+
+    TokenType type;
+
+    if (current.is_object) {
+      if (*begin == '}') {
+        (*position)++;
+        CloseContainer(&containers, tape);
+        if (containers.empty()) {
+          return true;
+        }
+        expects_value = false;
+        continue;
+      }
+
+      current.key_node = tape->nodes.size();
+      if (current.matches_schema &&
+          MatchKey(index, *position, *current.schema, current.count, tape)) {
+        (*position)++;
+      } else {
+        current.matches_schema = false;
+        if (!ParseKey(index, position, tape, error)) {
+          return false;
+        }
+      }
+
+      if (*position == token_count || GetTokenChar(index, *position) != ':') {
+        return SetError(error, kSyntaxError, "Unexpected token",
+                        GetTokenOffset(index, *position));
+      }
+      (*position)++;
+
+      if (*position == token_count) {
+        break;
+      }
+      begin = index.input + index.tokens[*position].offset;
+      if (*begin == ',') {
+        return SetError(error, kSyntaxError, "Value is missing in object",
+                        GetTokenOffset(index, *position));
+      }
+      if (!GetType(begin, index.input_end, &type)) {
+        return SetError(error, kTypeError, "Invalid type in object",
+                        GetTokenOffset(index, *position));
+      }
+    } else {
+      if (current.count == 0 && *begin == ']') {  // In case of empty array
+        (*position)++;
+        CloseContainer(&containers, tape);
+        if (containers.empty()) {
+          return true;
+        }
+        expects_value = false;
+        continue;
+      }
+
+      if (!GetType(begin, index.input_end, &type)) {
+        return SetError(error, kTypeError, "Invalid type in array",
+                        GetTokenOffset(index, *position));
+      }
+
+      // A closing bracket after a trailing comma is not an element.
+      if (type == kUndefinedToken && *begin == ']') {
+        expects_value = false;
+        continue;
+      }
+    }
+
+    if (type == kArrayToken || type == kObjectToken) {
+      if (!OpenContainer(index, position, max_depth, GetValueSchema(current),
+                         &containers, tape, error)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (!ParseToken(index, position, type, tape, error)) {
+      return false;
+    }
+    AddValue(&containers.back(), tape);
+    expects_value = false;
+  }
+
+  return SetError(error, kSyntaxError,
+                  containers.back().is_object ?
+                      "Missing closing brace in object" :
+                      "Missing closing bracket in array",
+                  GetTokenOffset(index, *position));
+}
+
+}  // namespace internal
+
+}  // namespace tape
+
+}  // namespace mdsf
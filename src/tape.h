@@ -0,0 +1,220 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_TAPE_H_
+#define SRC_TAPE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "tokenizer.h"
+
+// The V8-independent core of the parser. It validates the input and decodes
+// all of its values into a tape, which the bindings then turn into JavaScript
+// values, so it can be used without a JavaScript heap and off the main thread.
+
+namespace mdsf {
+
+namespace tape {
+
+// Maximal nesting depth of arrays and objects accepted by default.
+const std::size_t kDefaultMaxDepth = 1000;
+
+// Enumeration of the kinds of nodes a tape consists of.
+enum class NodeType : std::uint8_t {
+  kUndefined = 0, kNull, kTrue, kFalse, kNumber, kString, kArray, kObject
+};
+
+struct Schema;
+
+// A single value of the tape. Arrays and objects are followed by the nodes
+// of their contents: arrays by their elements and objects by pairs of nodes
+// for keys and values. Keys are strings, or numbers for numeric keys, which
+// have to be converted to strings the way JavaScript does it. Properties with
+// undefined values are left out.
+struct Node {
+  NodeType type;
+
+  // Whether a string consists of ASCII characters only, so that its bytes
+  // can be used as a one-byte string without decoding.
+  bool is_ascii;
+
+  // Size of a string in bytes, count of elements of an array or count of
+  // properties of an object.
+  std::uint32_t size;
+
+  union {
+    double number;
+    // UTF-8 contents of a string, either pointing into the input or, for
+    // strings that had to be unescaped, into the arena of the tape.
+    const char* string;
+    // The schema an object matches, i.e. has all of the keys of in the same
+    // order and nothing else, or nullptr.
+    const Schema* schema;
+  };
+};
+
+// The layout expected of an array or an object, which guides the parse.
+// Keys of an object found in the expected order are compared with the bytes
+// of the input instead of being classified character by character, and the
+// objects that match the schema entirely are marked in the tape, so that
+// they can be created with a layout built in advance. Anything else is
+// parsed as usual.
+struct Schema {
+  struct Key {
+    // Contents of the key encoded in UTF-8.
+    std::string text;
+    bool is_ascii;
+    // Whether the key is an identifier, which may be written without quotes.
+    bool is_identifier;
+  };
+
+  Schema() : is_array(false), id(0) {}
+
+  bool is_array;
+
+  // Keys of an object in the expected order. They must be unique, must not
+  // start with a digit and must not be `__proto__`.
+  std::vector<Key> keys;
+
+  // Schemas of the values of the keys of an object or, as the only one, of
+  // the elements of an array. Values of any layout are described by nullptr.
+  std::vector<const Schema*> values;
+
+  // Number of the schema among the ones built together, by which the data
+  // kept for it elsewhere can be found.
+  std::size_t id;
+};
+
+// The result of parsing an input. It refers to the input, which must outlive
+// it.
+struct Tape {
+  std::vector<Node> nodes;
+
+  // Storage of unescaped strings.
+  Arena arena;
+
+  // The structural index of the input, kept to reuse its memory between
+  // parses.
+  tokenizer::StructuralIndex index;
+};
+
+// Enumeration of JavaScript error types used to report parsing errors.
+enum ErrorType {
+  kSyntaxError = 0, kTypeError, kRangeError
+};
+
+// Description of the reason why the input can't be parsed.
+struct Error {
+  ErrorType type;
+  const char* message;
+  // Offset of the token at which the error was found from the beginning of
+  // the input.
+  std::size_t offset;
+};
+
+// Parses a UTF-8 encoded MDSF value from `begin` to `end` into `tape`,
+// replacing its previous contents. Arrays and objects may be nested at most
+// `max_depth` levels deep. The parse is guided by the `schema` if there is
+// one. The input is rejected if it is not valid UTF-8 and `validate_utf8` is
+// true, otherwise invalid sequences are left for V8 to replace. Returns true
+// on success, false otherwise, in which case `error` describes the problem.
+bool Parse(const char* begin, const char* end, Tape* tape, Error* error,
+           std::size_t max_depth = kDefaultMaxDepth,
+           const Schema* schema = nullptr,
+           bool validate_utf8 = false);
+
+// Same as Parse but only accepts objects, which is the case for JSTP
+// messages.
+bool ParseMessage(const char* begin, const char* end, Tape* tape,
+                  Error* error, std::size_t max_depth = kDefaultMaxDepth);
+
+namespace internal {
+
+// Parses an undefined value from `begin` but never past `end` and appends
+// its node to the `tape`. The `size` is set to the number of characters the
+// function has used in the string so that the calling side knows where to
+// continue from. Returns false and fills `error` if the input is malformed.
+bool ParseUndefined(const char* begin,
+                    const char* end,
+                    std::size_t* size,
+                    Tape* tape,
+                    Error* error);
+
+// Parses a null value from `begin` but never past `end` and appends its node
+// to the `tape`. The `size` is set to the number of characters the function
+// has used in the string so that the calling side knows where to continue
+// from.
+bool ParseNull(const char* begin,
+               const char* end,
+               std::size_t* size,
+               Tape* tape,
+               Error* error);
+
+// Parses a boolean value from `begin` but never past `end` and appends its
+// node to the `tape`. The `size` is set to the number of characters the
+// function has used in the string so that the calling side knows where to
+// continue from. Returns false and fills `error` if the input is malformed.
+bool ParseBool(const char* begin,
+               const char* end,
+               std::size_t* size,
+               Tape* tape,
+               Error* error);
+
+// Parses a numeric value from `begin` but never past `end` and appends its
+// node to the `tape`. The `size` is set to the number of characters the
+// function has used in the string so that the calling side knows where to
+// continue from. Returns false and fills `error` if the input is malformed.
+bool ParseNumber(const char* begin,
+                 const char* end,
+                 std::size_t* size,
+                 Tape* tape,
+                 Error* error);
+
+// Parses a string value from `begin` but never past `end` and appends its
+// node to the `tape`, unescaping it into the arena of the `tape` if needed.
+// The `size` is set to the number of characters the function has used in
+// the string so that the calling side knows where to continue from. Returns
+// false and fills `error` if the input is malformed.
+bool ParseString(const char* begin,
+                 const char* end,
+                 std::size_t* size,
+                 Tape* tape,
+                 Error* error);
+
+// Parses an object key from `begin` but never past `end` and appends its
+// string node to the `tape`. The `size` is set to the number of characters
+// the function has used in the string so that the calling side knows where
+// to continue from. Returns false and fills `error` if the input is
+// malformed.
+bool ParseKeyInObject(const char* begin,
+                      const char* end,
+                      std::size_t* size,
+                      Tape* tape,
+                      Error* error);
+
+// Parses an array or an object starting at the token `*position` of the
+// `index`, together with all of the arrays and objects nested in it, and
+// appends their nodes to the `tape`. Nested values are tracked on a stack of
+// their own rather than the native one, which is limited to `max_depth`
+// levels. The parse is guided by the `schema` of the container if there is
+// one. The `position` is advanced past the closing bracket or brace so that
+// the calling side knows where to continue from. Returns false and fills
+// `error` if the input is malformed or nested too deeply.
+bool ParseContainer(const tokenizer::StructuralIndex& index,
+                    std::size_t* position,
+                    std::size_t max_depth,
+                    Tape* tape,
+                    Error* error,
+                    const Schema* schema = nullptr);
+
+}  // namespace internal
+
+}  // namespace tape
+
+}  // namespace mdsf
+
+#endif  // SRC_TAPE_H_
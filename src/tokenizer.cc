@@ -0,0 +1,389 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#include "tokenizer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "simd_utils.h"
+#include "unicode_utils.h"
+
+using std::memchr;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+using mdsf::simd_utils::FindFirstOf;
+using mdsf::simd_utils::FindStringSpecialCharacter;
+using mdsf::simd_utils::SkipAsciiWhiteSpace;
+using mdsf::simd_utils::ValidateUtf8;
+using mdsf::unicode_utils::IsLineTerminatorSequence;
+using mdsf::unicode_utils::IsWhiteSpaceCharacter;
+using mdsf::unicode_utils::Utf8ToCodePoint;
+
+namespace mdsf {
+
+namespace tokenizer {
+
+// Returns the TokenType of the tokens starting with the byte `c`.
+static constexpr uint8_t GetTokenTypeOf(unsigned c) {
+  return c == ',' || c == ']' || c == 'u' ? kUndefinedToken :
+         c == 'n' ? kNullToken :
+         c == 't' || c == 'f' ? kBoolToken :
+         (c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-' ||
+             c == 'N' || c == 'I' ? kNumberToken :
+         c == '"' || c == '\'' ? kStringToken :
+         c == '[' ? kArrayToken :
+         c == '{' ? kObjectToken :
+         kInvalidToken;
+}
+
+// Returns the entry of the character class table for the byte `c`.
+static constexpr uint8_t GetCharClassOf(unsigned c) {
+  return GetTokenTypeOf(c) |
+         (c == ' ' || (c >= '\t' && c <= '\r') ?
+              kWhiteSpaceClass | kDelimiterClass : 0) |
+         (c == '{' || c == '}' || c == '[' || c == ']' || c == ',' ||
+              c == ':' ? kStructuralClass | kDelimiterClass : 0) |
+         (c == '\'' || c == '"' || c == '/' ? kDelimiterClass : 0) |
+         (c >= '0' && c <= '9' ? kDigitClass : 0) |
+         ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '$' ||
+              c == '_' ? kIdStartClass : 0);
+}
+
+#define MDSF_CHAR_CLASSES_4(c)                                   \
+  GetCharClassOf(c), GetCharClassOf(c + 1), GetCharClassOf(c + 2), \
+      GetCharClassOf(c + 3)
+#define MDSF_CHAR_CLASSES_16(c)                                  \
+  MDSF_CHAR_CLASSES_4(c), MDSF_CHAR_CLASSES_4(c + 4),            \
+      MDSF_CHAR_CLASSES_4(c + 8), MDSF_CHAR_CLASSES_4(c + 12)
+#define MDSF_CHAR_CLASSES_64(c)                                  \
+  MDSF_CHAR_CLASSES_16(c), MDSF_CHAR_CLASSES_16(c + 16),         \
+      MDSF_CHAR_CLASSES_16(c + 32), MDSF_CHAR_CLASSES_16(c + 48)
+
+constexpr uint8_t kCharClasses[256] = {
+  MDSF_CHAR_CLASSES_64(0u), MDSF_CHAR_CLASSES_64(64u),
+  MDSF_CHAR_CLASSES_64(128u), MDSF_CHAR_CLASSES_64(192u)
+};
+
+#undef MDSF_CHAR_CLASSES_64
+#undef MDSF_CHAR_CLASSES_16
+#undef MDSF_CHAR_CLASSES_4
+
+static_assert(kCharClasses['{'] == (kObjectToken | kStructuralClass |
+                                    kDelimiterClass),
+              "Invalid character class table");
+static_assert(kCharClasses['7'] == (kNumberToken | kDigitClass),
+              "Invalid character class table");
+static_assert(kCharClasses[0xE2] == kInvalidToken,
+              "Invalid character class table");
+
+// Returns count of bytes needed to skip to current comment ending.
+static size_t SkipToCommentEnd(const char* str, const char* end) {
+  if (str + 1 >= end) {
+    return 0;
+  }
+
+  const char* pos = str + 2;
+
+  switch (str[1]) {
+    case '/': {  // Single line comment ends with a line terminator sequence
+      while (pos < end) {
+        pos += FindFirstOf(pos, end, '\x0A', '\x0D', '\xE2');
+        if (pos == end) {
+          break;
+        }
+        size_t terminator_size;
+        if (end - pos >= 3 || *pos != '\xE2') {
+          if (IsLineTerminatorSequence(pos, &terminator_size)) {
+            return pos + terminator_size - str;
+          }
+        }
+        pos++;
+      }
+      return end - str;
+    }
+    case '*': {
+      while (pos < end) {
+        pos = static_cast<const char*>(memchr(pos, '*', end - pos));
+        if (!pos || pos + 1 >= end) {
+          break;
+        }
+        if (pos[1] == '/') {
+          return pos + 2 - str;
+        }
+        pos++;
+      }
+      return 0;
+    }
+    default: {  // In case it is not a comment start
+      return 0;
+    }
+  }
+}
+
+size_t SkipToNextToken(const char* str, const char* end) {
+  const char* pos = str;
+  size_t current_size;
+
+  while (pos < end) {
+    if (GetCharClass(*pos) & kWhiteSpaceClass) {
+      pos += SkipAsciiWhiteSpace(pos, end);
+    } else if (*pos == '/') {
+      size_t to_skip = SkipToCommentEnd(pos, end);
+      if (!to_skip) {
+        break;
+      }
+      pos += to_skip;
+    } else if (static_cast<unsigned char>(*pos) >= 0x80 &&
+               (IsWhiteSpaceCharacter(pos, &current_size) ||
+                IsLineTerminatorSequence(pos, &current_size))) {
+      pos += current_size;
+    } else {
+      break;
+    }
+  }
+
+  return pos - str;
+}
+
+// Returns a pointer past the end of the string literal starting at `begin`,
+// or `end` if it is not terminated. `is_plain` receives false if the literal
+// has to be processed by the parser (it contains escape sequences or line
+// terminators or is not terminated) and true if its contents can be used as
+// is. `is_ascii` receives false if the literal contains non-ASCII characters.
+static const char* SkipString(const char* begin,
+                              const char* end,
+                              bool* is_plain,
+                              bool* is_ascii) {
+  const char quote = *begin;
+  const char* pos = begin + 1;
+  *is_plain = true;
+  *is_ascii = true;
+
+  while (true) {
+    pos += FindStringSpecialCharacter(pos, end, quote, is_ascii);
+    if (pos >= end) {
+      *is_plain = false;
+      return end;
+    }
+
+    if (*pos == quote) {
+      return pos + 1;
+    }
+
+    if (*pos == '\\') {
+      *is_plain = false;
+      if (end - pos >= 2 && static_cast<unsigned char>(pos[1]) >= 0x80) {
+        *is_ascii = false;
+      }
+      // Skip the escaped character, treating CRLF in line continuations as a
+      // single one.
+      pos += (end - pos >= 3 && pos[1] == '\x0D' && pos[2] == '\x0A') ? 3 : 2;
+    } else if (*pos != '\xE2' ||
+               (end - pos >= 3 && pos[1] == '\x80' &&
+                (pos[2] == '\xA8' || pos[2] == '\xA9'))) {
+      *is_plain = false;  // Unescaped line terminator
+      pos++;
+    } else {
+      *is_ascii = false;
+      pos++;
+    }
+  }
+}
+
+// Returns a pointer past the end of the number, identifier or literal
+// starting at `begin`. Escape sequences in identifiers are skipped as a whole
+// even if they contain delimiters. `is_ascii` receives false if the token
+// contains non-ASCII characters.
+static const char* SkipBareToken(const char* begin,
+                                 const char* end,
+                                 bool* is_ascii) {
+  const char* pos = begin;
+  size_t current_size;
+  *is_ascii = true;
+
+  while (pos < end) {
+    if (static_cast<unsigned char>(*pos) < 0x80) {
+      if (GetCharClass(*pos) & kDelimiterClass) {
+        break;
+      }
+      if (*pos == '\\' && end - pos >= 3 && pos[1] == 'u' && pos[2] == '{') {
+        // Braces of a Unicode code point escape in an identifier are a part
+        // of it.
+        const char* escape_end = static_cast<const char*>(
+            memchr(pos + 3, '}', end - pos - 3));
+        pos = escape_end ? escape_end + 1 : end;
+      } else {
+        pos++;
+      }
+    } else {
+      if (IsWhiteSpaceCharacter(pos, &current_size) ||
+          IsLineTerminatorSequence(pos, &current_size)) {
+        break;
+      }
+      *is_ascii = false;
+      Utf8ToCodePoint(pos, &current_size);
+      pos += current_size;
+    }
+  }
+
+  return pos < end ? pos : end;
+}
+
+namespace {
+
+// An array or an object which has been opened but not closed yet.
+struct Container {
+  // Index of the opening bracket or brace token.
+  size_t token;
+  char closing_char;
+  // Count of commas for arrays, count of colons for objects.
+  uint32_t separator_count;
+  // Whether there has been an element since the last comma in an array.
+  bool has_element;
+};
+
+}  // namespace
+
+// Returns true if the part of the input from `begin` to `end` is valid UTF-8,
+// otherwise writes the offset of the first invalid sequence in it from the
+// beginning of the `input` to `invalid_offset` and returns false.
+static bool CheckUtf8(const char* input,
+                      const char* begin,
+                      const char* end,
+                      size_t*     invalid_offset) {
+  const size_t valid_size = ValidateUtf8(begin, end);
+  if (begin + valid_size == end) {
+    return true;
+  }
+  *invalid_offset = begin + valid_size - input;
+  return false;
+}
+
+bool Tokenize(const char*      begin,
+              const char*      end,
+              StructuralIndex* index,
+              bool             validate_utf8,
+              size_t*          invalid_offset) {
+  vector<Token>& tokens = index->tokens;
+  vector<Container> containers;
+  index->input = begin;
+  index->input_end = end;
+  tokens.clear();
+
+  const char* pos = begin;
+
+  while (true) {
+    const char* token_begin = pos + SkipToNextToken(pos, end);
+    // Non-ASCII white space characters are matched exactly, so only the runs
+    // long enough to contain a comment may be invalid.
+    if (validate_utf8 && token_begin - pos >= 2 &&
+        !CheckUtf8(begin, pos, token_begin, invalid_offset)) {
+      return false;
+    }
+    pos = token_begin;
+    if (pos >= end) {
+      break;
+    }
+
+    Token token;
+    token.offset = static_cast<uint32_t>(pos - begin);
+    token.size = 0;
+    token.is_ascii = false;
+    token.needs_unescaping = false;
+
+    Container* current = containers.empty() ? nullptr : &containers.back();
+
+    switch (*pos) {
+      case '{':
+      case '[': {
+        if (current) {
+          current->has_element = true;
+        }
+        Container container;
+        container.token = tokens.size();
+        container.closing_char = *pos == '{' ? '}' : ']';
+        container.separator_count = 0;
+        container.has_element = false;
+        containers.push_back(container);
+        pos++;
+        break;
+      }
+      case '}':
+      case ']': {
+        // Mismatched brackets are left for the parser to report.
+        if (current && current->closing_char == *pos) {
+          uint32_t count = current->separator_count;
+          if (*pos == ']' && current->has_element) {
+            count++;
+          }
+          tokens[current->token].size = count;
+          containers.pop_back();
+        }
+        pos++;
+        break;
+      }
+      case ',': {
+        if (current && current->closing_char == ']') {
+          current->separator_count++;
+          current->has_element = false;
+        }
+        pos++;
+        break;
+      }
+      case ':': {
+        if (current && current->closing_char == '}') {
+          current->separator_count++;
+        }
+        pos++;
+        break;
+      }
+      case '\'':
+      case '"': {
+        if (current) {
+          current->has_element = true;
+        }
+        bool is_plain;
+        bool is_ascii;
+        const char* string_end = SkipString(pos, end, &is_plain, &is_ascii);
+        if (validate_utf8 && !is_ascii &&
+            !CheckUtf8(begin, pos, string_end, invalid_offset)) {
+          return false;
+        }
+        token.size = static_cast<uint32_t>(string_end - pos);
+        token.is_ascii = is_plain && is_ascii;
+        token.needs_unescaping = !is_plain;
+        pos = string_end;
+        break;
+      }
+      default: {
+        if (current) {
+          current->has_element = true;
+        }
+        bool is_ascii;
+        const char* token_end = SkipBareToken(pos, end, &is_ascii);
+        if (token_end == pos) {  // Unexpected character, e.g. lone slash
+          token_end++;
+        }
+        if (validate_utf8 && !is_ascii &&
+            !CheckUtf8(begin, pos, token_end, invalid_offset)) {
+          return false;
+        }
+        token.size = static_cast<uint32_t>(token_end - pos);
+        pos = token_end;
+      }
+    }
+
+    tokens.push_back(token);
+  }
+
+  return true;
+}
+
+}  // namespace tokenizer
+
+}  // namespace mdsf
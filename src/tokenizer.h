@@ -0,0 +1,116 @@
+// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef SRC_TOKENIZER_H_
+#define SRC_TOKENIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mdsf {
+
+namespace tokenizer {
+
+// Maximal size of an input the structural index can describe.
+const std::size_t kMaxInputSize = INT32_MAX;
+
+// Types of values that tokens stand for, determined by their first
+// character. Commas and closing brackets stand for elided array elements.
+enum TokenType : std::uint8_t {
+  kUndefinedToken = 0,
+  kNullToken,
+  kBoolToken,
+  kNumberToken,
+  kStringToken,
+  kArrayToken,
+  kObjectToken,
+  kInvalidToken
+};
+
+// Every entry of the character class table holds the TokenType of the tokens
+// starting with the character in the bits of kTokenTypeMask, combined with
+// the following flags. Bytes of non-ASCII characters have no flags and are of
+// kInvalidToken type.
+const std::uint8_t kTokenTypeMask = 0x07;
+// White space or line terminator.
+const std::uint8_t kWhiteSpaceClass = 0x08;
+// Terminates a number, an identifier or a literal.
+const std::uint8_t kDelimiterClass = 0x10;
+// Decimal digit.
+const std::uint8_t kDigitClass = 0x20;
+// May start an identifier: a Latin letter, `$` or `_`.
+const std::uint8_t kIdStartClass = 0x40;
+// Bracket, brace, comma or colon.
+const std::uint8_t kStructuralClass = 0x80;
+
+// The character class table indexed with bytes of the input.
+extern const std::uint8_t kCharClasses[256];
+
+inline std::uint8_t GetCharClass(char c) {
+  return kCharClasses[static_cast<unsigned char>(c)];
+}
+
+inline TokenType GetTokenType(char c) {
+  return static_cast<TokenType>(GetCharClass(c) & kTokenTypeMask);
+}
+
+// Unlike std::isdigit() it doesn't depend on the current locale.
+inline bool IsAsciiDigit(char c) {
+  return (GetCharClass(c) & kDigitClass) != 0;
+}
+
+// An entry of the structural index describing a single token of the input:
+// a brace, a bracket, a colon, a comma, a string or a run of characters that
+// make up a number, an identifier or a literal such as `true` or `null`.
+// The kind of the token is determined by its first character.
+struct Token {
+  // Offset of the first character of the token from the beginning of the
+  // input.
+  std::uint32_t offset : 31;
+
+  // Whether the token is a string which doesn't need to be unescaped and
+  // consists of ASCII characters only.
+  std::uint32_t is_ascii : 1;
+
+  // Count of elements for an opening bracket or count of properties for an
+  // opening brace, as long as the closing one is found. Size of the token in
+  // bytes, including the quotes, for strings and other scalar tokens, zero
+  // for the rest of the structural characters.
+  std::uint32_t size : 31;
+
+  // Whether the token is a string which needs to be unescaped or is
+  // malformed, so that its contents can't be used as is.
+  std::uint32_t needs_unescaping : 1;
+};
+
+// The structural index of an input, i.e. the list of all of its tokens in
+// the order they appear in it, with white space and comments left out.
+struct StructuralIndex {
+  const char* input;
+  const char* input_end;
+  std::vector<Token> tokens;
+};
+
+// Builds the structural index of the input from `begin` to `end` into
+// `index`, reusing the memory it has already allocated. The input must not be
+// larger than kMaxInputSize. Malformed tokens are not reported here but by
+// the parsing stage that consumes them. If `validate_utf8` is true, the
+// tokens and comments containing non-ASCII characters are also checked to be
+// valid UTF-8 while they are scanned. Returns false if they are not, in which
+// case `invalid_offset` receives the offset of the first invalid sequence
+// from `begin` and the index is left incomplete, true otherwise.
+bool Tokenize(const char*      begin,
+              const char*      end,
+              StructuralIndex* index,
+              bool             validate_utf8 = false,
+              std::size_t*     invalid_offset = nullptr);
+
+// Returns count of bytes needed to skip to next token.
+std::size_t SkipToNextToken(const char* str, const char* end);
+
+}  // namespace tokenizer
+
+}  // namespace mdsf
+
+#endif  // SRC_TOKENIZER_H_
@@ -8,10 +8,13 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "simd_utils.h"
 #include "unicode_tables.h"
 
 using std::size_t;
+using std::uint16_t;
 using std::uint32_t;
+using std::uint64_t;
 
 namespace mdsf {
 
@@ -142,62 +145,69 @@ uint32_t Utf8ToCodePoint(const char* begin, size_t* size) {
   return result;
 }
 
-#ifdef _PARSER_USE_FULL_TABLES_
-
-bool IsIdStartCodePoint(uint32_t cp) {
-  return ID_START_FULL[cp];
-}
-
-bool IsIdPartCodePoint(uint32_t cp) {
-  return ID_CONTINUE_FULL[cp];
-}
-
-#undef _PARSER_USE_FULL_TABLES_
-#else
-
-bool search_cp(uint32_t cp, const unicode_range* ranges, size_t size) {
-  size_t low = 0;
-  size_t high = size;
-  while (high > low) {
-    size_t mid = low + (high - low) / 2;
-    unicode_range range = ranges[mid];
-    if (range.start <= cp && cp <= range.end) {
-      return true;
+size_t Utf8ToUtf16(const char* begin,
+                   const char* end,
+                   uint16_t*   out,
+                   bool*       is_one_byte) {
+  auto pos = reinterpret_cast<const unsigned char*>(begin);
+  auto last = reinterpret_cast<const unsigned char*>(end);
+  uint16_t* const out_begin = out;
+  uint32_t all_bits = 0;
+
+  while (pos < last) {
+    const size_t run_length = simd_utils::FindNonAscii(
+        reinterpret_cast<const char*>(pos), end);
+    for (size_t i = 0; i < run_length; i++) {
+      out[i] = pos[i];
     }
-    if (cp < range.start) {
-      high = mid;
-    } else {
-      low = mid + 1;
+    pos += run_length;
+    out += run_length;
+
+    // The input being valid, the continuation bytes are neither checked nor
+    // bounded by `end`.
+    while (pos < last && *pos >= 0x80) {
+      uint32_t c;
+      if (*pos < 0xE0) {
+        c = (pos[0] & 0x1F) << 6 | (pos[1] & 0x3F);
+        pos += 2;
+      } else if (*pos < 0xF0) {
+        c = (pos[0] & 0x0F) << 12 | (pos[1] & 0x3F) << 6 | (pos[2] & 0x3F);
+        pos += 3;
+      } else {
+        c = (pos[0] & 0x07) << 18 | (pos[1] & 0x3F) << 12 |
+            (pos[2] & 0x3F) << 6 | (pos[3] & 0x3F);
+        pos += 4;
+        c -= 0x10000;
+        *out++ = static_cast<uint16_t>(0xD800 + (c >> 10));
+        c = 0xDC00 + (c & 0x3FF);
+      }
+      all_bits |= c;
+      *out++ = static_cast<uint16_t>(c);
     }
   }
-  return false;
+
+  *is_one_byte = all_bits < 0x100;
+  return out - out_begin;
+}
+
+// Looks the code point `cp` up in the two-level trie of the table with the
+// `index`. Code points past the ones the index covers are looked up as 0,
+// which isn't a part of an identifier, so that there is nothing to branch on.
+static inline bool LookUpIdTrie(const id_trie_index* index, uint32_t cp) {
+  cp = cp < ID_TRIE_LIMIT ? cp : 0;
+  const uint64_t* block = ID_TRIE_BLOCKS[index[cp >> ID_TRIE_SHIFT]];
+  const uint32_t offset = cp & ((1u << ID_TRIE_SHIFT) - 1);
+  return (block[offset >> 6] >> (offset & 63)) & 1;
 }
 
 bool IsIdStartCodePoint(uint32_t cp) {
-  if (('a' <= cp && cp <= 'z') ||
-      ('A' <= cp && cp <= 'Z') ||
-      cp == '_' ||
-      cp == '$') {
-    return true;
-  }
-  return search_cp(cp, ID_START_RANGES, ID_START_RANGES_COUNT);
+  return LookUpIdTrie(ID_START_TRIE_INDEX, cp);
 }
 
 bool IsIdPartCodePoint(uint32_t cp) {
-  if (('a' <= cp && cp <= 'z') ||
-      ('A' <= cp && cp <= 'Z') ||
-      ('0' <= cp && cp <= '9') ||
-      cp == '_' ||
-      cp == '$') {
-    return true;
-  }
-  return search_cp(cp, ID_CONTINUE_RANGES, ID_CONTINUE_RANGES_COUNT) ||
-                   cp == 0x200C || cp == 0x200D; // ZWNJ, ZWJ
+  return LookUpIdTrie(ID_CONTINUE_TRIE_INDEX, cp);
 }
 
-#endif
-
-
 }  // namespace unicode_utils
 
 }  // namespace mdsf
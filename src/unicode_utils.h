@@ -31,6 +31,15 @@ void CodePointToUtf8(unsigned int c, std::size_t* size, char* write_to);
 // `size` will receive the number of bytes the code point occupies.
 std::uint32_t Utf8ToCodePoint(const char* begin, std::size_t* size);
 
+// Decodes the valid UTF-8 from `begin` to `end` into UTF-16 code units
+// written to `out`, which must have room for `end - begin` of them. Returns
+// the count of code units written. `is_one_byte` will receive whether all of
+// them are below 0x100.
+std::size_t Utf8ToUtf16(const char*    begin,
+                        const char*    end,
+                        std::uint16_t* out,
+                        bool*          is_one_byte);
+
 // Checks whether the given Unicode code point is a valid IdentifierStart.
 bool IsIdStartCodePoint(std::uint32_t cp);
 
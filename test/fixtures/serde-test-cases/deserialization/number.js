@@ -21,4 +21,29 @@ module.exports = [
     value: 0xaf,
     serialized: '0xAF',
   },
+  {
+    name: 'hexadecimal numbers exceeding 64 bits',
+    value: 295147905179352830000,
+    serialized: '0xfffffffffffffffff',
+  },
+  {
+    name: 'binary numbers rounded to even',
+    value: 9007199254740992,
+    serialized: '0b100000000000000000000000000000000000000000000000000001',
+  },
+  {
+    name: 'decimal numbers with more than 19 digits',
+    value: 0.1,
+    serialized: '0.1000000000000000055511151231257827021181583404541015625',
+  },
+  {
+    name: 'decimal numbers halfway between two doubles',
+    value: 9007199254740996,
+    serialized: '9007199254740995',
+  },
+  {
+    name: 'subnormal numbers',
+    value: 5e-324,
+    serialized: '4.9406564584124654e-324',
+  },
 ];
@@ -16,4 +16,29 @@ module.exports = [
     value: { key: 42 },
     serialized: '{"key": 42}',
   },
+  {
+    name: 'object with long whitespace runs',
+    value: { key: [42, 'value'] },
+    serialized:
+      '{\n                                    key:\t\t\t\t\t\t\t\t\t\t\t\t[\n' +
+      "      42,\r\n                                       'value'\n]\n}",
+  },
+  {
+    name: 'object with comments',
+    value: { key: 42, other: 'value' },
+    serialized:
+      '{ // the comment that spans more than thirty two bytes of input\n' +
+      '  key: /* a multiline comment that also has ** asterisks */ 42,\r' +
+      "  other: /*\n * the last comment\n */ 'value' // trailing\n}",
+  },
+  {
+    name: 'object with ASCII identifier keys',
+    value: { $a1: 1, _: 2, A_$9: 3, z0: 4 },
+    serialized: '{$a1:1,_:2,A_$9:3,z0:4}',
+  },
+  {
+    name: 'object with duplicate keys',
+    value: { key: 'last', 1: 'last' },
+    serialized: "{key: 'first', '1': 'first', key: 'last', \"1\": 'last'}",
+  },
 ];
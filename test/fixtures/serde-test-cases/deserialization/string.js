@@ -11,4 +11,12 @@ module.exports = [
     value: 'Hello',
     serialized: "'\\x48\\x65\\x6c\\x6c\\x6f'",
   },
+  {
+    name: 'long string with escape sequences',
+    value:
+      'A'.repeat(100) + '\n' + 'B'.repeat(40) + "'\u2028" + 'Ü'.repeat(20),
+    serialized:
+      "'" + 'A'.repeat(100) + '\\n' + 'B'.repeat(40) + "\\'\\u2028" +
+      'Ü'.repeat(20) + "'",
+  },
 ];
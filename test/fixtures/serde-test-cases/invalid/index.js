@@ -53,4 +53,16 @@ module.exports = [
     name: 'overflow in Unicode escape sequence',
     value: "'\\u{420420}'",
   },
+  {
+    name: 'mismatched brackets',
+    value: '[{key:[42}]]',
+  },
+  {
+    name: 'missing comma between array elements',
+    value: '[42 43]',
+  },
+  {
+    name: 'number followed by an identifier',
+    value: '{key:42key}',
+  },
 ];
@@ -0,0 +1,89 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsParser = require('../../lib/serde-fallback');
+
+const schema = {
+  id: 'number',
+  name: 'string',
+  'first-name': 'string',
+  'a"b\\c\n': 'any',
+  'ключ': 'boolean',
+  points: [{ x: 'number', y: 'number' }],
+  nested: { a: { b: ['string'] } },
+};
+
+const inputs = [
+  "{id:1,name:'n','first-name':'f','a\"b\\\\c\\n':[],'ключ':true," +
+    'points:[{x:1,y:2},{x:3,y:4}],nested:{a:{b:[]}}}',
+  '{"id":1,"name":"n","first-name":"f","a\\"b\\\\c\\n":{},"ключ":false,' +
+    '"points":[],"nested":{"a":{"b":["c"]}}}',
+  '{id:1}',
+  '{name:1,id:2}',
+  '{id:1,name:undefined,extra:2}',
+  "{'i\\u0064':1,points:[{x:1},{y:2,x:1},[1],1,{x:1,y:2,z:3}]}",
+  '{id:1,id:2}',
+  '[{id:1}]',
+  "'str'",
+];
+
+const runTests = (parserName, parser) => {
+  const parse = parser.compileParser(schema);
+
+  test(`must parse the same way as parse() using ${parserName}`, test => {
+    inputs.forEach(input => {
+      test.strictSame(parse(input), parser.parse(input), input);
+      test.strictSame(parse(Buffer.from(input)), parser.parse(input), input);
+    });
+    test.end();
+  });
+
+  test(`must keep the order of properties using ${parserName}`, test => {
+    const value = parse(inputs[0]);
+    test.strictSame(Object.keys(value), Object.keys(schema));
+    test.strictSame(Object.keys(value.points[1]), ['x', 'y']);
+    test.end();
+  });
+
+  test(`must set prototypes by __proto__ keys using ${parserName}`, test => {
+    const value = parse('{id:1,__proto__:{a:1}}');
+    test.strictSame(Object.keys(value), ['id']);
+    test.strictSame(Object.getPrototypeOf(value), { a: 1 });
+    test.end();
+  });
+
+  test(`must parse with scalar schemas using ${parserName}`, test => {
+    test.strictSame(parser.compileParser('any')('{a:[1]}'), { a: [1] });
+    test.strictSame(parser.compileParser(['number'])('[1,2]'), [1, 2]);
+    test.strictSame(parser.compileParser({})('{}'), {});
+    test.end();
+  });
+
+  test(`must report errors using ${parserName}`, test => {
+    ['{id:}', '{id:1', '{"id:1}', '{id:1,,}'].forEach(input => {
+      test.throws(() => parse(input));
+    });
+    test.end();
+  });
+
+  test(`must reject invalid schemas using ${parserName}`, test => {
+    const schemas = [
+      null,
+      'date',
+      [],
+      ['number', 'string'],
+      { a: 1 },
+      { 1: 'number' },
+      JSON.parse('{"__proto__":"number"}'),
+    ];
+    schemas.forEach(schema => {
+      test.throws(() => parser.compileParser(schema), TypeError);
+    });
+    test.end();
+  });
+};
+
+runTests('native parser', mdsf);
+runTests('js parser', jsParser);
@@ -0,0 +1,89 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsSerializer = require('../../lib/serde-fallback');
+
+const schema = {
+  id: 'number',
+  name: 'string',
+  'first-name': 'string',
+  active: 'boolean',
+  tags: ['string'],
+  points: [{ x: 'number', y: 'number' }],
+  meta: 'any',
+};
+
+const matching = [
+  {
+    id: 1,
+    name: 'name',
+    'first-name': 'é\'"\\\n\uD800',
+    active: false,
+    tags: ['a', , 'b'],
+    points: [{ x: 1.5, y: -0 }, { x: NaN, y: 1e21 }],
+    meta: { a: [Buffer.from('buf'), null, new Date(0)] },
+  },
+  { id: 2, name: 'name', active: true, tags: [], points: [], meta: 'str' },
+  { name: undefined, meta: null },
+  {},
+];
+
+const runTests = (serializerName, serializer) => {
+  const stringify = serializer.compileStringifier(schema);
+
+  test(`must stringify matching values using ${serializerName}`, test => {
+    matching.forEach(value => {
+      test.strictSame(stringify(value), serializer.stringify(value));
+    });
+    test.end();
+  });
+
+  test(`must skip other properties using ${serializerName}`, test => {
+    const value = { extra: 1, name: 'name', id: 1, points: [{ x: 1, z: 2 }] };
+    test.strictSame(stringify(value), "{id:1,name:'name',points:[{x:1}]}");
+    test.end();
+  });
+
+  test(`must fall back on mismatching values using ${serializerName}`, test => {
+    const mismatching = [
+      { id: '1' },
+      { tags: [1] },
+      { points: {} },
+      { points: [null] },
+      { meta: () => {} },
+      { meta: { toMDSF: key => key } },
+      { toMDSF: () => 'value' },
+      Object.assign(Object.create(null), { id: 1 }),
+      new Date(0),
+      [],
+      'str',
+      undefined,
+    ];
+    mismatching.forEach(value => {
+      test.strictSame(stringify(value), serializer.stringify(value));
+    });
+    test.end();
+  });
+
+  test(`must stringify scalar schemas using ${serializerName}`, test => {
+    test.strictSame(serializer.compileStringifier('number')(-1.5), '-1.5');
+    test.strictSame(serializer.compileStringifier('string')("'"), "'\\''");
+    test.strictSame(
+      serializer.compileStringifier(['any'])([1, 'a']),
+      "[1,'a']"
+    );
+    test.end();
+  });
+
+  test(`must reject invalid schemas using ${serializerName}`, test => {
+    [null, 'date', [], ['number', 'string'], { a: 1 }].forEach(schema => {
+      test.throws(() => serializer.compileStringifier(schema), TypeError);
+    });
+    test.end();
+  });
+};
+
+runTests('native serializer', mdsf);
+runTests('js serializer', jsSerializer);
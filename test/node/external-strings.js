@@ -0,0 +1,28 @@
+'use strict';
+
+const test = require('tap').test;
+const mdsf = require('../..');
+
+const longString = 'x'.repeat(4096);
+const options = { externalStrings: true };
+
+test('must create long strings from the copy of the input', test => {
+  const buffer = Buffer.from(`{data: '${longString}', short: 'y'}`);
+  const result = mdsf.parse(buffer, options);
+  buffer.fill(0);
+  test.strictSame(result, { data: longString, short: 'y' });
+  test.end();
+});
+
+test('must properly parse long escaped and non-ASCII strings', test => {
+  const escaped = `${longString}\\n`;
+  const nonAscii = `${longString}ё`;
+  const result = mdsf.parse(`['${escaped}', '${nonAscii}']`, options);
+  test.strictSame(result, [`${longString}\n`, nonAscii]);
+  test.end();
+});
+
+test('must throw on options of a wrong type', test => {
+  test.throws(() => mdsf.parse('1', 'options'), TypeError);
+  test.end();
+});
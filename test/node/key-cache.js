@@ -0,0 +1,30 @@
+'use strict';
+
+const test = require('tap').test;
+const mdsf = require('../..');
+
+test('must reuse cached object keys', test => {
+  const before = mdsf.getKeyCacheStats();
+  mdsf.parse('{cachedKey: 1}');
+  const result = mdsf.parse('{cachedKey: 2}');
+  const after = mdsf.getKeyCacheStats();
+  test.strictSame(result, { cachedKey: 2 });
+  test.ok(after.hits > before.hits);
+  test.ok(after.size <= after.capacity);
+  test.end();
+});
+
+test('must properly parse keys evicted from the cache', test => {
+  const keys = [];
+  for (let i = 0; i < 4096; i++) {
+    keys.push(`key${i}`);
+  }
+  const expected = {};
+  keys.forEach((key, i) => {
+    expected[key] = i;
+  });
+  const serialized = `{${keys.map((key, i) => `${key}:${i}`).join(',')}}`;
+  test.strictSame(mdsf.parse(serialized), expected);
+  test.strictSame(mdsf.parse(serialized), expected);
+  test.end();
+});
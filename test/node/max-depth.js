@@ -0,0 +1,67 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsParser = require('../../lib/serde-fallback');
+
+const nest = (depth, open, close, value = '1') =>
+  open.repeat(depth) + value + close.repeat(depth);
+
+const runTests = (parserName, parser) => {
+  test(`must reject deeply nested values using ${parserName} parser`, test => {
+    const serialized = nest(100000, '[', ']');
+    test.throws(() => parser.parse(serialized), SyntaxError);
+    test.end();
+  });
+
+  test(`must respect maxDepth option using ${parserName} parser`, test => {
+    const options = { maxDepth: 3 };
+    test.strictSame(parser.parse(nest(3, '[', ']'), options), [[[1]]]);
+    test.strictSame(parser.parse(nest(3, '{a:', '}'), options), {
+      a: { a: { a: 1 } },
+    });
+    test.strictSame(parser.parse('[[1], {a: [2]}, 3]', options), [
+      [1],
+      { a: [2] },
+      3,
+    ]);
+    test.throws(() => parser.parse(nest(4, '[', ']'), options), SyntaxError);
+    test.throws(() => parser.parse(nest(4, '{a:', '}'), options), SyntaxError);
+    test.strictSame(parser.parse('1', { maxDepth: 0 }), 1);
+    test.throws(() => parser.parse('[]', { maxDepth: 0 }), SyntaxError);
+    test.end();
+  });
+
+  test(`must respect maxDepth option in parseAsync using ${parserName}`, test =>
+    test.rejects(parser.parseAsync(nest(5, '[', ']'), { maxDepth: 4 })));
+};
+
+runTests('native', mdsf);
+runTests('js', jsParser);
+
+test('must create values nested deeper than the native stack allows', test => {
+  const depth = 100000;
+  const options = { maxDepth: Infinity };
+  let array = mdsf.parse(nest(depth, '[', ']'), options);
+  let object = mdsf.parse(nest(depth, '{a:', '}'), options);
+  for (let i = 0; i < depth; i++) {
+    array = array[0];
+    object = object.a;
+  }
+  test.strictSame(array, 1);
+  test.strictSame(object, 1);
+  test.end();
+});
+
+test('must create deeply nested values in parseAsync', test =>
+  mdsf
+    .parseAsync(nest(100000, '[', ']'), { maxDepth: Infinity })
+    .then(value => test.ok(Array.isArray(value))));
+
+test('must throw on invalid maxDepth values', test => {
+  test.throws(() => mdsf.parse('1', { maxDepth: '1' }), TypeError);
+  test.throws(() => mdsf.parse('1', { maxDepth: -1 }), RangeError);
+  test.throws(() => mdsf.parse('1', { maxDepth: 1.5 }), RangeError);
+  test.end();
+});
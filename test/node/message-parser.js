@@ -21,3 +21,37 @@ testCases.forEach(testCase => {
   runTest('native', mdsf);
   runTest('js', jsParser);
 });
+
+testCases.forEach(testCase => {
+  const runTest = (parserName, parser) => {
+    test(`must properly parse ${
+      testCase.name
+    } from a buffer using ${parserName} parser`, test => {
+      const prefix = Buffer.from('{skipped:1}\0');
+      const message = Buffer.from(testCase.message);
+      const buffer = Buffer.concat([prefix, message]);
+      const result = [];
+      const parsedLength = parser.parseJSTPMessages(
+        buffer,
+        result,
+        prefix.length
+      );
+      test.strictSame(result, testCase.result);
+      test.strictSame(
+        parsedLength,
+        message.length - Buffer.byteLength(testCase.remainder)
+      );
+      test.end();
+    });
+  };
+  runTest('native', mdsf);
+  runTest('js', jsParser);
+});
+
+test('must throw on offsets out of range', test => {
+  const buffer = Buffer.from('{a:1}\0');
+  test.throws(() => mdsf.parseJSTPMessages(buffer, [], 7), RangeError);
+  test.throws(() => mdsf.parseJSTPMessages(buffer, [], -1), RangeError);
+  test.throws(() => jsParser.parseJSTPMessages(buffer, [], 7), RangeError);
+  test.end();
+});
@@ -0,0 +1,147 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsStringify = require('../../lib/stringify');
+
+const date = new Date(Date.UTC(2019, 0, 1));
+
+const values = [
+  ['integers', [0, -0, 1, -1, 2 ** 31, -(2 ** 31) - 1, 2 ** 53 - 1, 1e20]],
+  ['other numbers', [0.1, -1.5e-7, 1e21, 2 ** 53, NaN, Infinity, -Infinity]],
+  ['literals', [true, false, null, undefined]],
+  ['escaped characters', `'"\\\b\f\n\r\t\v\0\x1F\x7F  `],
+  ['non-ASCII strings', ['été', 'при', '\u{1F600}']],
+  ['lone surrogates', ['\uD800', 'a\uDC00b', '\uDBFF𐀀']],
+  ['long non-ASCII runs', ['я'.repeat(300), '😀\uD800'.repeat(200) + "'"]],
+  ['keys', { a1: 1, _$: 2, '1a': 3, 'a-b': 4, '': 5, 7: 6, 'é': 7 }],
+  ['sparse arrays', [1, , 3, undefined, () => {}, Symbol('s'), 1n, ,]],
+  ['omitted properties', { a: undefined, b: () => {}, c: Symbol('s'), d: 1 }],
+  ['wrapper objects', [new Number(4), new String('s'), new Boolean(false)]],
+  ['buffers', [Buffer.from(''), Buffer.from('a'), Buffer.from('ab')]],
+  ['buffer slices', Buffer.from('abcdef').slice(1, 5)],
+  ['typed arrays', new Uint8Array([1, 2])],
+  ['dates', { date }],
+  ['nested values', { a: [{ b: { c: [[]] } }, {}], d: { e: [1, [2, {}]] } }],
+];
+
+const spaces = [undefined, 2, 20, 1.5, -1, '\t', '--------------', '😀'];
+
+test('must stringify the same way as the JavaScript implementation', test => {
+  values.forEach(([name, value]) => {
+    spaces.forEach(space => {
+      test.strictSame(
+        mdsf.nativeStringify(value, null, space),
+        jsStringify(value, null, space),
+        `${name} with space ${JSON.stringify(space)}`
+      );
+    });
+  });
+  test.end();
+});
+
+test('must support wrapped space arguments', test => {
+  const value = { a: [1] };
+  [new Number(3), new String(' ')].forEach(space => {
+    test.strictSame(
+      mdsf.nativeStringify(value, null, space),
+      jsStringify(value, null, space)
+    );
+  });
+  test.end();
+});
+
+test('must filter keys by replacer arrays', test => {
+  const value = { 1: 1, a: { a: 2, b: 3 }, b: 4, c: 5 };
+  const replacers = [[], ['a', 1], [new String('b'), new Number(1), {}, true]];
+  replacers.forEach(replacer => {
+    test.strictSame(
+      mdsf.nativeStringify(value, replacer),
+      jsStringify(value, replacer)
+    );
+  });
+  test.end();
+});
+
+test('must pass keys to toMDSF() and toJSON() methods', test => {
+  const keys = [];
+  const value = {
+    toMDSF(key) {
+      keys.push(key);
+      return [{ toJSON: key => keys.push(key) }];
+    },
+  };
+  test.strictSame(mdsf.nativeStringify({ a: value }), '{a:[2]}');
+  test.strictSame(keys, ['a', '0']);
+  test.end();
+});
+
+test('must propagate exceptions', test => {
+  const error = new Error('error');
+  const throwError = () => {
+    throw error;
+  };
+  const getter = Object.defineProperty({}, 'a', {
+    get: throwError,
+    enumerable: true,
+  });
+  test.throws(() => mdsf.nativeStringify({ toMDSF: throwError }), error);
+  test.throws(() => mdsf.nativeStringify(getter), error);
+  test.throws(() => mdsf.nativeStringify({ a: 1 }, throwError), error);
+  test.end();
+});
+
+test('must not overflow the stack on circular structures', test => {
+  const value = {};
+  value.value = [value];
+  test.throws(() => mdsf.nativeStringify(value), RangeError);
+  test.end();
+});
+
+test('must escape characters at any position of long strings', test => {
+  const specialCharacters = ["'", '"', '\\', '\n', '\x1F', '\x7F', 'é', 'ж'];
+  const padding = 'a'.repeat(70);
+  specialCharacters.forEach(special => {
+    [padding, padding.replace(/a/g, 'я')].forEach(text => {
+      for (let position = 0; position <= text.length; position++) {
+        const value = text.slice(0, position) + special + text.slice(position);
+        const expected = jsStringify(value);
+        if (mdsf.nativeStringify(value) !== expected) {
+          test.strictSame(mdsf.nativeStringify(value), expected);
+          return;
+        }
+      }
+      test.ok(true, `${JSON.stringify(special)} is escaped`);
+    });
+  });
+  test.end();
+});
+
+test('must find toMDSF() and toJSON() methods anywhere', test => {
+  const toJSON = () => 'json';
+  class Value {
+    toMDSF() {
+      return 'mdsf';
+    }
+  }
+  const values = [
+    Object.defineProperty({}, 'toJSON', { value: toJSON }),
+    Object.defineProperty({}, 'toJSON', { get: () => toJSON }),
+    Object.assign(Object.create(null), { toJSON }),
+    Object.create({ toJSON }),
+    new Value(),
+    { toMDSF: 1, toJSON },
+    new Proxy({}, { get: (target, key) => (key === 'toJSON' ? toJSON : 0) }),
+  ];
+  values.forEach(value => {
+    test.strictSame(mdsf.nativeStringify(value), jsStringify(value));
+  });
+
+  // eslint-disable-next-line no-extend-native
+  Array.prototype.toJSON = toJSON;
+  const result = mdsf.nativeStringify([[1]]);
+  delete Array.prototype.toJSON;
+  test.strictSame(result, "'json'");
+  test.end();
+});
@@ -0,0 +1,27 @@
+'use strict';
+
+const test = require('tap').test;
+const mdsf = require('../..');
+
+test('must properly parse strings with non-ASCII characters anywhere', test => {
+  for (let length = 0; length < 80; length++) {
+    const ascii = 'a'.repeat(length);
+    test.strictSame(mdsf.parse(`'${ascii}'`), ascii);
+    test.strictSame(mdsf.parse(`'${ascii}ё'`), `${ascii}ё`);
+    test.strictSame(mdsf.parse(`'ё${ascii}'`), `ё${ascii}`);
+  }
+  test.end();
+});
+
+test('must properly parse escape sequences of non-ASCII characters', test => {
+  const result = mdsf.parse("['a\\u0451', 'a\\u{1F600}', 'a\\n']");
+  test.strictSame(result, ['aё', 'a\u{1F600}', 'a\n']);
+  test.end();
+});
+
+test('must properly parse non-ASCII object keys', test => {
+  const serialized = "{ключ: 1, 'ключ2': 2, k\\u0451y: 3, key: 4}";
+  const result = mdsf.parse(serialized);
+  test.strictSame(result, { ключ: 1, ключ2: 2, kёy: 3, key: 4 });
+  test.end();
+});
@@ -0,0 +1,39 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsParser = require('../../lib/serde-fallback');
+
+const testCases = require('../fixtures/serde-test-cases');
+
+testCases.serde.concat(testCases.deserialization).forEach(testCase => {
+  const runTest = (parserName, parser) => {
+    test(`must asynchronously deserialize ${
+      testCase.name
+    } using ${parserName} parser`, test =>
+      parser.parseAsync(Buffer.from(testCase.serialized)).then(value => {
+        test.strictSame(value, testCase.value);
+      }));
+  };
+  runTest('native', mdsf);
+  runTest('js', jsParser);
+});
+
+testCases.invalid.forEach(testCase => {
+  const runTest = (parserName, parser) => {
+    test(`must reject ${testCase.name} using ${parserName} parser`, test =>
+      test.rejects(parser.parseAsync(Buffer.from(testCase.value))));
+  };
+  runTest('native', mdsf);
+  runTest('js', jsParser);
+});
+
+test('must not be affected by changes to the input buffer', test => {
+  const buffer = Buffer.from("{ key: 'value' }");
+  const promise = mdsf.parseAsync(buffer);
+  buffer.fill(0);
+  return promise.then(value => {
+    test.strictSame(value, { key: 'value' });
+  });
+});
@@ -0,0 +1,41 @@
+'use strict';
+
+const test = require('tap').test;
+const mdsf = require('../..');
+
+test('must properly parse many escaped strings in a large input', test => {
+  const count = 100000;
+  const expected = [];
+  for (let i = 0; i < count; i++) {
+    expected.push(`a\n${i}`);
+  }
+  const serialized = `[${expected.map((s, i) => `'a\\n${i}'`).join(',')}]`;
+  test.strictSame(mdsf.parse(serialized), expected);
+  test.strictSame(mdsf.parse("['b\\n']"), ['b\n']);
+  test.end();
+});
+
+test('must support parsing from a setter called by the parser', test => {
+  const descriptor = Object.getOwnPropertyDescriptor(
+    Object.prototype,
+    '__proto__'
+  );
+  let nested = null;
+  Object.defineProperty(Object.prototype, '__proto__', {
+    configurable: true,
+    set(value) {
+      nested = mdsf.parse("{inner: 'x\\ty'}");
+      descriptor.set.call(this, value);
+    },
+  });
+  let result;
+  try {
+    result = mdsf.parse("{before: 'a\\tb', __proto__: null, after: 'c\\td'}");
+  } finally {
+    Object.defineProperty(Object.prototype, '__proto__', descriptor);
+  }
+  test.strictSame(nested, { inner: 'x\ty' });
+  test.equal(result.before, 'a\tb');
+  test.equal(result.after, 'c\td');
+  test.end();
+});
@@ -0,0 +1,32 @@
+'use strict';
+
+const test = require('tap').test;
+const mdsf = require('../..');
+
+test('must properly parse objects of repeated layouts', test => {
+  for (let i = 0; i < 3; i++) {
+    const result = mdsf.parse(`{call:[${i},'auth'],signIn:['user',${i}]}`);
+    test.strictSame(result, { call: [i, 'auth'], signIn: ['user', i] });
+    test.strictSame(Object.keys(result), ['call', 'signIn']);
+  }
+  test.end();
+});
+
+test('must keep the order of keys of similar layouts', test => {
+  const layouts = ['{a:1,b:2}', '{b:2,a:1}', '{a:1,b:2,c:3}', '{a:1}'];
+  for (let i = 0; i < 3; i++) {
+    layouts.forEach(layout => {
+      const result = mdsf.parse(layout);
+      test.strictSame(Object.keys(result), layout.match(/[a-c]/g));
+    });
+  }
+  test.end();
+});
+
+test('must properly parse repeated layouts with duplicate keys', test => {
+  for (let i = 0; i < 3; i++) {
+    const result = mdsf.parse(`{a:1,b:${i},a:${i}}`);
+    test.strictSame(result, { a: i, b: i });
+  }
+  test.end();
+});
@@ -0,0 +1,59 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsParser = require('../../lib/serde-fallback');
+
+const messages = [{ a: 1 }, { b: 'ключ' }, { c: [1, { d: null }] }];
+const serialized = "{a:1}\0{b:'ключ'}\0{c:[1,{d:null}]}\0";
+
+const runTests = (parserName, parser) => {
+  test(`must parse messages split at any byte using ${parserName}`, test => {
+    const buffer = Buffer.from(serialized);
+    for (let i = 0; i <= buffer.length; i++) {
+      const streamParser = new parser.StreamParser();
+      const result = [];
+      streamParser.write(buffer.slice(0, i), result);
+      streamParser.write(buffer.slice(i), result);
+      test.strictSame(result, messages);
+    }
+    test.end();
+  });
+
+  test(`must parse messages written by bytes using ${parserName}`, test => {
+    const streamParser = new parser.StreamParser();
+    const buffer = Buffer.from(serialized);
+    const result = [];
+    for (let i = 0; i < buffer.length; i++) {
+      streamParser.write(buffer.slice(i, i + 1), result);
+    }
+    test.strictSame(result, messages);
+    test.end();
+  });
+
+  test(`must parse messages from strings using ${parserName}`, test => {
+    const streamParser = new parser.StreamParser();
+    const result = [];
+    streamParser.write('{a:', result);
+    test.strictSame(result, []);
+    streamParser.write('1}\0{b:2}\0{c:', result);
+    test.strictSame(result, [{ a: 1 }, { b: 2 }]);
+    streamParser.write('3}\0', result);
+    test.strictSame(result, [{ a: 1 }, { b: 2 }, { c: 3 }]);
+    test.end();
+  });
+
+  test(`must discard pending data on errors using ${parserName}`, test => {
+    const streamParser = new parser.StreamParser();
+    const result = [];
+    streamParser.write('{a:', result);
+    test.throws(() => streamParser.write('}\0{b:', result), SyntaxError);
+    streamParser.write('{c:3}\0', result);
+    test.strictSame(result, [{ c: 3 }]);
+    test.end();
+  });
+};
+
+runTests('native', mdsf);
+runTests('js', jsParser);
@@ -0,0 +1,80 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsSerializer = require('../../lib/serde-fallback');
+
+const value = {
+  a: [1, -20, 1.5, 'str', 'при', Buffer.from('buf'), null, undefined],
+  'b c': { d: true, e: new String('s'), f: () => {} },
+};
+const serialized = mdsf.stringify(value);
+const serializedLength = Buffer.byteLength(serialized);
+
+const runTests = (serializerName, serializer) => {
+  test(`must stringify into a new Buffer using ${serializerName}`, test => {
+    const result = serializer.stringifyToBuffer(value);
+    test.ok(Buffer.isBuffer(result));
+    test.equal(result.toString(), serialized);
+    test.end();
+  });
+
+  test(`must stringify into a target using ${serializerName}`, test => {
+    const target = Buffer.alloc(serializedLength + 10, '-');
+    const result = serializer.stringifyToBuffer(value, target, 5);
+    test.equal(result.buffer, target.buffer);
+    test.equal(result.byteOffset, target.byteOffset + 5);
+    test.equal(result.toString(), serialized);
+    test.equal(
+      target.toString(),
+      `-----${serialized}-----`,
+      'must not write past the output'
+    );
+    test.end();
+  });
+
+  test(`must not overflow a target using ${serializerName}`, test => {
+    const target = Buffer.alloc(serializedLength, '-');
+    const result = serializer.stringifyToBuffer(value, target, 1);
+    test.ok(result.buffer !== target.buffer);
+    test.equal(result.toString(), serialized);
+    test.equal(target[0], '-'.charCodeAt(0), 'must not write before offset');
+    test.end();
+  });
+
+  test(`must check offsets using ${serializerName}`, test => {
+    const target = Buffer.alloc(8);
+    [-1, 9, 0.5].forEach(offset => {
+      test.throws(
+        () => serializer.stringifyToBuffer(1, target, offset),
+        RangeError
+      );
+    });
+    test.equal(serializer.stringifyToBuffer(1, target, 8).toString(), '1');
+    test.end();
+  });
+
+  test(`must estimate sizes using ${serializerName}`, test => {
+    const exact = [1, -20, 'str', 'при', Buffer.from('buf'), [1, , 2], {}];
+    exact.forEach(value => {
+      test.equal(
+        serializer.estimateSize(value),
+        serializer.stringifyToBuffer(value).length
+      );
+    });
+    test.ok(serializer.estimateSize(value) >= serializedLength);
+    test.end();
+  });
+
+  test(`must not call methods to estimate using ${serializerName}`, test => {
+    const value = {
+      toMDSF: () => test.fail('toMDSF() must not be called'),
+    };
+    test.ok(serializer.estimateSize(value) > 0);
+    test.end();
+  });
+};
+
+runTests('native serializer', mdsf);
+runTests('js serializer', jsSerializer);
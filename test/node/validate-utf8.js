@@ -0,0 +1,104 @@
+'use strict';
+
+const test = require('tap').test;
+
+const mdsf = require('../..');
+const jsParser = require('../../lib/serde-fallback');
+
+const options = { validateUtf8: true };
+
+// Creates a Buffer of the strings and arrays of bytes.
+const bytes = (...parts) => Buffer.concat(parts.map(part => Buffer.from(part)));
+
+const valid = [
+  bytes("{a:'привет',b:'😀',c:'\\u00e9','ключ':'\u00a0'}"),
+  bytes('/* коммент */ [1, "é"] // 😀'),
+  bytes(`'${'ж'.repeat(40)}${'a'.repeat(33)}${'😀'.repeat(20)}'`),
+  bytes("'\uffff\u{10ffff}\u0080\u07ff\u0800'"),
+];
+
+const invalid = [
+  { name: 'lone byte', input: bytes("'ab", [0xff], "'"), offset: 3 },
+  { name: 'stray continuation', input: bytes("'", [0x80], "'"), offset: 1 },
+  { name: 'overlong 2', input: bytes("'", [0xc1, 0xbf], "'"), offset: 1 },
+  { name: 'overlong 3', input: bytes("'", [0xe0, 0x9f, 0xbf], "'"), offset: 1 },
+  {
+    name: 'overlong 4',
+    input: bytes("'", [0xf0, 0x8f, 0xbf, 0xbf], "'"),
+    offset: 1,
+  },
+  { name: 'surrogate', input: bytes("'x", [0xed, 0xa0, 0x80], "'"), offset: 2 },
+  {
+    name: 'code point above U+10FFFF',
+    input: bytes("'", [0xf4, 0x90, 0x80, 0x80], "'"),
+    offset: 1,
+  },
+  { name: 'truncated sequence', input: bytes("'", [0xe2, 0x82]), offset: 1 },
+  {
+    name: 'sequence cut by a quote',
+    input: bytes("['", [0xe2, 0x82], "']"),
+    offset: 2,
+  },
+  { name: 'escaped byte', input: bytes("'\\", [0xff], "'"), offset: 2 },
+  { name: 'comment', input: bytes('/* ', [0xfe], ' */1'), offset: 3 },
+  { name: 'key', input: bytes('{ab', [0xc0, 0x80], ':1}'), offset: 3 },
+  { name: 'value', input: bytes('[1,', [0xf8], ']'), offset: 3 },
+];
+
+const runTests = (parserName, parser) => {
+  test(`must parse valid UTF-8 using ${parserName}`, test => {
+    valid.forEach(input => {
+      test.strictSame(parser.parse(input, options), parser.parse(input));
+    });
+    // Strings are never invalid, even with lone surrogates.
+    test.strictSame(
+      parser.parse("'\uD800'", options),
+      parser.parse("'\uD800'")
+    );
+    test.end();
+  });
+
+  invalid.forEach(testCase => {
+    test(`must reject invalid ${testCase.name} using ${parserName}`, test => {
+      test.throws(
+        () => parser.parse(testCase.input, options),
+        { name: 'SyntaxError', offset: testCase.offset },
+        testCase.input.toString('hex')
+      );
+      test.end();
+    });
+  });
+
+  test(`must find errors at any offset using ${parserName}`, test => {
+    const prefix = Buffer.from(`'${'a'.repeat(20)}${'ж'.repeat(40)}`);
+    for (let offset = 1; offset < prefix.length; offset++) {
+      if ((prefix[offset] & 0xc0) === 0x80) continue;
+      [[0xff], [0xd0], [0xe2, 0x82], [0xf0, 0x9f, 0x98]].forEach(sequence => {
+        const input = bytes(prefix.slice(0, offset), sequence, "'");
+        test.throws(
+          () => parser.parse(input, options),
+          { offset },
+          input.toString('hex')
+        );
+      });
+    }
+    test.end();
+  });
+
+  test(`must replace invalid UTF-8 by default using ${parserName}`, test => {
+    test.strictSame(parser.parse(bytes("'a", [0xff], "'")), 'a\uFFFD');
+    test.end();
+  });
+
+  test(`must reject invalid UTF-8 asynchronously using ${parserName}`, test =>
+    parser
+      .parseAsync(bytes("{a:'", [0xff], "'}"), options)
+      .then(() => test.fail('must be rejected'))
+      .catch(error => {
+        test.ok(error instanceof SyntaxError);
+        test.strictSame(error.offset, 4);
+      }));
+};
+
+runTests('native parser', mdsf);
+runTests('js parser', jsParser);
@@ -0,0 +1,53 @@
+#!/usr/bin/env node
+
+'use strict';
+
+// Measures the time it takes to parse objects with unquoted keys made up of
+// ASCII, BMP and astral identifier characters, which the native parser
+// classifies with the Unicode tables generated by make-unicode-tables.js.
+//
+// Usage: node tools/bench-identifier-keys.js [iterations]
+
+const mdsf = require('..');
+
+const KEYS_PER_OBJECT = 64;
+const KEY_LENGTH = 32;
+const ITERATIONS = parseInt(process.argv[2], 10) || 20000;
+
+const keyAlphabets = {
+  ascii: ['a', 'Z', '_', '$', 'k', 'q', '0', '9'],
+  bmp: ['ж', 'я', 'é', 'ß', '名', '前', 'α', 'ω'],
+  astral: ['\u{10400}', '\u{10428}', '\u{1D400}', '\u{20000}', '\u{2A6D6}'],
+};
+
+// Creates the source of an object of KEYS_PER_OBJECT unique keys of
+// KEY_LENGTH characters of the `alphabet`, none of which starts with a digit.
+const createObjectSource = alphabet => {
+  const letters = alphabet.filter(c => !/\d/.test(c));
+  const properties = [];
+  for (let i = 0; i < KEYS_PER_OBJECT; i++) {
+    const characters = [letters[i % letters.length]];
+    let n = i;
+    while (characters.length < KEY_LENGTH) {
+      characters.push(alphabet[n % alphabet.length]);
+      n = Math.floor(n / alphabet.length);
+    }
+    properties.push(`${characters.join('')}:${i}`);
+  }
+  return `{${properties.join(',')}}`;
+};
+
+Object.keys(keyAlphabets).forEach(name => {
+  const source = Buffer.from(createObjectSource(keyAlphabets[name]));
+  for (let i = 0; i < ITERATIONS / 10; i++) {
+    mdsf.parse(source);
+  }
+  const start = process.hrtime();
+  for (let i = 0; i < ITERATIONS; i++) {
+    mdsf.parse(source);
+  }
+  const [seconds, nanoseconds] = process.hrtime(start);
+  const time = seconds * 1e9 + nanoseconds;
+  const perKey = time / ITERATIONS / KEYS_PER_OBJECT;
+  console.log(`${name} keys: ${perKey.toFixed(1)} ns per key`);
+});
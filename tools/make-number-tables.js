@@ -0,0 +1,82 @@
+#!/usr/bin/env node
+
+'use strict';
+
+/* global BigInt */
+
+const fs = require('fs');
+const path = require('path');
+
+const tablesFilename = 'number_tables.h';
+const getHeaderGuard = filename =>
+  `SRC_${filename.replace(/\W/g, '_').toUpperCase()}_`;
+const getOutputPath = filename => path.join(__dirname, '../src', filename);
+
+// The range of decimal exponents that may produce a finite non-zero double.
+const smallestPowerOfFive = -342;
+const largestPowerOfFive = 308;
+
+const getFileHeader = filename =>
+  `// Copyright (c) 2019 mdsf project authors. Use of this source code is
+// governed by the MIT license that can be found in the LICENSE file.
+//
+// This file is automatically generated by tools/make-number-tables.js.
+//
+// Do not edit this file manually!
+
+#ifndef ${getHeaderGuard(filename)}
+#define ${getHeaderGuard(filename)}
+
+#include <cstdint>
+
+`;
+
+const one = BigInt(1);
+const two = BigInt(2);
+const five = BigInt(5);
+const bits64 = BigInt(64);
+const bits128 = BigInt(128);
+const mask64 = (one << bits64) - one;
+
+const bitLength = value => value.toString(2).length;
+
+// Returns the 128 most significant bits of 5^q, truncated for positive `q`
+// and rounded up for negative ones, so that the product of a 64-bit mantissa
+// and the table entry is never less than the exact one.
+function getPowerOfFive(q) {
+  if (q >= 0) {
+    const power = five ** BigInt(q);
+    const shift = BigInt(bitLength(power) - 128);
+    return shift > 0 ? power >> shift : power << -shift;
+  }
+  const power = five ** BigInt(-q);
+  const z = BigInt(bitLength(power - one));
+  if (q >= -27) {
+    return two ** (z + BigInt(127)) / power + one;
+  }
+  let result = two ** (two * z + bits128) / power + one;
+  while (result >= one << bits128) {
+    result /= two;
+  }
+  return result;
+}
+
+const toHex = value => `0x${value.toString(16).padStart(16, '0')}`;
+
+let tablesResult = getFileHeader(tablesFilename);
+tablesResult += `const int SMALLEST_POWER_OF_FIVE = ${smallestPowerOfFive};\n`;
+tablesResult += `const int LARGEST_POWER_OF_FIVE = ${largestPowerOfFive};\n\n`;
+tablesResult +=
+  '// Pairs of the high and low 64-bit halves of 128-bit approximations\n' +
+  '// of the powers of five from SMALLEST_POWER_OF_FIVE to\n' +
+  '// LARGEST_POWER_OF_FIVE.\n';
+tablesResult += 'const std::uint64_t POWERS_OF_FIVE_128[] = {\n';
+for (let q = smallestPowerOfFive; q <= largestPowerOfFive; q++) {
+  const power = getPowerOfFive(q);
+  const high = toHex(power >> bits64);
+  const low = toHex(power & mask64);
+  tablesResult += `  ${high}, ${low},  // 5^${q}\n`;
+}
+tablesResult += '};\n\n';
+tablesResult += `#endif  // ${getHeaderGuard(tablesFilename)}\n`;
+fs.writeFileSync(getOutputPath(tablesFilename), tablesResult);
@@ -7,13 +7,12 @@ const http = require('http');
 const path = require('path');
 const readline = require('readline');
 
-const UNICODE_VERSION = '12.0.0';
+const UNICODE_VERSION = '16.0.0';
 const UCD_LINK =
   'http://www.unicode.org/Public/' +
   UNICODE_VERSION +
   '/ucd/DerivedCoreProperties.txt';
 const tablesFilename = 'unicode_tables.h';
-const generateFullTables = !process.env['MDSF_USE_SHORT_UNICODE_TABLES'];
 const getHeaderGuard = filename =>
   `SRC_${filename.replace(/\W/g, '_').toUpperCase()}_`;
 const getOutputPath = filename => path.join(__dirname, '../src', filename);
@@ -28,7 +27,7 @@ const getFileHeader = filename =>
 //
 // COPYRIGHT AND PERMISSION NOTICE
 //
-// Copyright © 1991-2019 Unicode, Inc. All rights reserved.
+// Copyright © 1991-2024 Unicode, Inc. All rights reserved.
 // Distributed under the Terms of Use in https://www.unicode.org/copyright.html.
 //
 // Permission is hereby granted, free of charge, to any person obtaining
@@ -71,29 +70,21 @@ const getFileHeader = filename =>
 
 `;
 
-const rangeTablesHeader = `#include <cstddef>
-#include <cstdint>
-
-using std::size_t;
-using std::uint32_t;
-
-typedef struct {
-  uint32_t start;
-  uint32_t end;
-} unicode_range;
-
-`;
-
 const idStartCategoryName = 'ID_Start';
 const idContinueCategoryName = 'ID_Continue';
 
 const highestUnicodeValue = 0x10ffff;
 
-const idStartValues = new Array(highestUnicodeValue + 1);
-const idContinueValues = new Array(highestUnicodeValue + 1);
+// Code points are looked up in a two-level trie: the code point shifted right
+// by `trieShift` bits selects a block in the index of a table, and the rest
+// of its bits select a bit in the bitmap of the block. Identical blocks, most
+// of which are empty or full, are stored once and shared by both tables.
+const trieShift = 8;
+const blockSize = 1 << trieShift;
+const blockWords = blockSize / 64;
 
-const idStartRanges = [];
-const idContinueRanges = [];
+const idStartValues = new Uint8Array(highestUnicodeValue + 1);
+const idContinueValues = new Uint8Array(highestUnicodeValue + 1);
 
 let idStartTotalCount = 0;
 let idContinueTotalCount = 0;
@@ -111,75 +102,135 @@ http.get(UCD_LINK, res => {
       const endValue = parseInt(end || start, 16);
       if (category === idStartCategoryName) {
         idStartTotalCount += endValue - startValue + 1;
-        idStartRanges.push([startValue, endValue]);
-        for (let i = startValue; i <= endValue; i++) {
-          idStartValues[i] = 1;
-        }
+        idStartValues.fill(1, startValue, endValue + 1);
       } else if (category === idContinueCategoryName) {
         idContinueTotalCount += endValue - startValue + 1;
-        idContinueRanges.push([startValue, endValue]);
-        for (let i = startValue; i <= endValue; i++) {
-          idContinueValues[i] = 1;
-        }
+        idContinueValues.fill(1, startValue, endValue + 1);
       }
     }
   });
   linereader.on('close', finish);
 });
 
-function createFullTableArray(arrayName, array) {
-  let str = `const unsigned char ${arrayName}[]={0,`;
-  for (let i = 1; i <= highestUnicodeValue; i++) {
-    str += array[i] ? '1' : '0';
-    str += ',';
+// Returns the bitmap of the block of code points starting at `start` as an
+// array of 64-bit words written in hexadecimal.
+function getBlockWords(values, start) {
+  const words = [];
+  for (let word = 0; word < blockWords; word++) {
+    let digits = '';
+    for (let nibble = 15; nibble >= 0; nibble--) {
+      const base = start + word * 64 + nibble * 4;
+      const digit =
+        values[base] |
+        (values[base + 1] << 1) |
+        (values[base + 2] << 2) |
+        (values[base + 3] << 3);
+      digits += digit.toString(16);
+    }
+    words.push(`0x${digits}`);
   }
-  str += '};\n';
-  return str;
+  return words;
 }
 
-function createArrayOfRanges(arrayName, array) {
-  let str = `const unicode_range ${arrayName}[] = {\n  `;
-  array.forEach((range, index) => {
-    str += `{0x${range[0].toString(16)}, 0x${range[1].toString(16)}}`;
-    if (index !== array.length - 1) {
-      if ((index + 1) % 3 === 0) {
-        str += ',\n  ';
-      } else {
-        str += ', ';
-      }
-    } else {
-      str += '\n';
+// Splits the `values` into blocks, adding the new ones to `blocks`, and
+// returns the indices of the blocks of the first `indexSize` ones.
+function createTrieIndex(values, indexSize, blocks, blockIds) {
+  const index = [];
+  for (let i = 0; i < indexSize; i++) {
+    const words = getBlockWords(values, i * blockSize);
+    const key = words.join();
+    if (!blockIds.has(key)) {
+      blockIds.set(key, blocks.length);
+      blocks.push(words);
     }
+    index.push(blockIds.get(key));
+  }
+  return index;
+}
+
+// Returns the count of blocks up to the last one with any of the `values`.
+function getIndexSize(...tables) {
+  let last = 0;
+  tables.forEach(values => {
+    last = Math.max(last, values.lastIndexOf(1));
   });
-  str += '};\n\n';
-  str += `const size_t ${arrayName}_COUNT = ${array.length};\n\n`;
-  return str;
+  return (last >> trieShift) + 1;
+}
+
+function createIndexArray(arrayName, index) {
+  let str = `const id_trie_index ${arrayName}[] = {`;
+  index.forEach((block, i) => {
+    str += i % 16 === 0 ? '\n  ' : ' ';
+    str += `${block},`;
+  });
+  return `${str}\n};\n\n`;
+}
+
+function createBlocksArray(arrayName, blocks) {
+  let str = `const uint64_t ${arrayName}[][${blockWords}] = {\n`;
+  blocks.forEach(words => {
+    str += `  {${words.slice(0, 2).join(', ')},\n`;
+    str += `   ${words.slice(2).join(', ')}},\n`;
+  });
+  return `${str}};\n\n`;
 }
 
 function finish() {
   console.log(`ID_Start code points found: ${idStartTotalCount}`);
   console.log(`ID_Continue code points found: ${idContinueTotalCount}`);
 
+  idStartValues[0x24] = 1; // '$'
+  idContinueValues[0x24] = 1;
+
+  idStartValues[0x5f] = 1; // '_'
+  idContinueValues[0x5f] = 1;
+
+  idContinueValues[0x200c] = 1; // ZWNJ
+  idContinueValues[0x200d] = 1; // ZWJ
+
+  const indexSize = getIndexSize(idStartValues, idContinueValues);
+  const blocks = [];
+  const blockIds = new Map();
+  // The first block is the empty one code points past the index fall back to.
+  createTrieIndex(new Uint8Array(blockSize), 1, blocks, blockIds);
+  const startIndex = createTrieIndex(
+    idStartValues,
+    indexSize,
+    blocks,
+    blockIds
+  );
+  const continueIndex = createTrieIndex(
+    idContinueValues,
+    indexSize,
+    blocks,
+    blockIds
+  );
+  const indexType = blocks.length <= 0x100 ? 'uint8_t' : 'uint16_t';
+  const tablesSize =
+    (indexType === 'uint8_t' ? 2 : 4) * indexSize +
+    blocks.length * blockWords * 8;
+  console.log(`Trie blocks: ${blocks.length}, size: ${tablesSize} bytes`);
+
   let tablesResult = getFileHeader(tablesFilename);
+  tablesResult += `#include <cstdint>
 
-  if (generateFullTables) {
-    idStartValues[0x24] = 1; // '$'
-    idContinueValues[0x24] = 1;
+using std::${indexType};
+using std::uint32_t;
+using std::uint64_t;
 
-    idStartValues[0x5f] = 1; // '_'
-    idContinueValues[0x5f] = 1;
+typedef ${indexType} id_trie_index;
 
-    idContinueValues[0x200c] = 1; // ZWNJ
-    idContinueValues[0x200d] = 1; // ZWJ
-
-    tablesResult += createFullTableArray('ID_START_FULL', idStartValues);
-    tablesResult += createFullTableArray('ID_CONTINUE_FULL', idContinueValues);
-  } else {
-    tablesResult += rangeTablesHeader;
-    tablesResult += createArrayOfRanges('ID_START_RANGES', idStartRanges);
-    tablesResult += createArrayOfRanges('ID_CONTINUE_RANGES', idContinueRanges);
-  }
+// Code points are looked up in two-level tries. The code point shifted right
+// by ID_TRIE_SHIFT bits selects a block of ID_TRIE_BLOCKS in the index of a
+// table, and the rest of its bits select a bit in the block. Code points from
+// ID_TRIE_LIMIT on are neither identifier starts nor parts.
+const uint32_t ID_TRIE_SHIFT = ${trieShift};
+const uint32_t ID_TRIE_LIMIT = 0x${(indexSize << trieShift).toString(16)};
 
+`;
+  tablesResult += createIndexArray('ID_START_TRIE_INDEX', startIndex);
+  tablesResult += createIndexArray('ID_CONTINUE_TRIE_INDEX', continueIndex);
+  tablesResult += createBlocksArray('ID_TRIE_BLOCKS', blocks);
   tablesResult += `#endif  // ${getHeaderGuard(tablesFilename)}\n`;
   fs.writeFileSync(getOutputPath(tablesFilename), tablesResult);
 }